@@ -0,0 +1,200 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file admission.hpp
+ * @brief Admission control, maximum age and eviction of the processes run by a device.
+ */
+
+#ifndef FCPP_ADMISSION_H_
+#define FCPP_ADMISSION_H_
+
+#include <cstdint>
+#include <iterator>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "lib/generals.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+
+//! @brief Orders in which running processes are evicted to admit new ones.
+enum class eviction_order : uint8_t {
+    oldest,   //!< Oldest message first.
+    farthest, //!< Farthest destination first.
+    priority  //!< Lowest service type first, then oldest message.
+};
+
+//! @brief Names of the eviction orders.
+constexpr char const* eviction_names[] = {"oldest", "farthest", "priority"};
+
+//! @brief Rank of a process for eviction (lowest first).
+using eviction_rank = std::pair<real_t, times_t>;
+
+/**
+ * @brief Rank of the process of a message for eviction by a device (lowest first).
+ *
+ * The position of the destination is read from its node, standing in for a location service.
+ */
+template <typename node_t>
+eviction_rank process_rank(node_t& node, eviction_order e, message const& m) {
+    switch (e) {
+        case eviction_order::oldest:
+            return {0, m.time};
+        case eviction_order::farthest:
+            return {-norm(node.net.node_at(m.to).position(node.current_time()) - node.position(node.current_time())), m.time};
+        case eviction_order::priority:
+            return {m.svc_type, m.time};
+    }
+    return {0, m.time};
+}
+
+
+/**
+ * @brief Processes admitted by a device across rounds.
+ *
+ * At most `cap` processes run at once (if positive), and none past `ttl` from the creation of
+ * its message (if positive). A process reaching a device which already runs `cap` processes in
+ * the round evicts the lowest ranked of them if it ranks higher, and is refused otherwise
+ * (rejected if new, evicted if it was running). Since the evicted process already ran in the
+ * round, it stops in the next round it runs, so that a device may run more than `cap` processes
+ * for a single round. Processes rejected or evicted are never admitted again, until they are
+ * older than `horizon`. Without limits, processes are admitted with no bookkeeping.
+ */
+class admission_state {
+  public:
+    //! @brief Set of messages.
+    using message_set = std::unordered_set<message, common::hash<message>>;
+
+    //! @brief Starts a round.
+    void begin(size_t cap, times_t ttl, times_t horizon, times_t now) {
+        m_cap = cap;
+        m_ttl = ttl;
+        m_now = now;
+        m_running = 0;
+        m_rejected = m_evicted = 0;
+        m_dropped.clear();
+        for (auto it = m_refused.begin(); it != m_refused.end(); )
+            it = now - it->time > horizon ? m_refused.erase(it) : std::next(it);
+    }
+
+    //! @brief Whether the process of a message can run in the current round, given a ranking function.
+    template <typename F>
+    bool admit(message const& m, F&& rank) {
+        if (m_cap == 0 and m_ttl <= 0) return true;
+        if (m_refused.count(m)) return drop(m);
+        bool running = m_last.count(m);
+        size_t& refusals = running ? m_evicted : m_rejected;
+        if (m_victims.count(m) or (m_ttl > 0 and m_now - m.time > m_ttl)) {
+            ++refusals;
+            return refuse(m);
+        }
+        if (m_cap > 0 and m_running >= m_cap) {
+            // the lowest ranked process run in the round, which this one should outrank
+            message const* victim = nullptr;
+            eviction_rank worst;
+            for (message const& x : m_current) {
+                if (m_victims.count(x)) continue;
+                eviction_rank r = rank(x);
+                if (victim == nullptr or r < worst) {
+                    victim = &x;
+                    worst = r;
+                }
+            }
+            if (victim == nullptr or not (worst < rank(m))) {
+                ++refusals;
+                return refuse(m);
+            }
+            m_victims.insert(*victim);
+            --m_running;
+        }
+        ++m_running;
+        m_current.insert(m);
+        return true;
+    }
+
+    //! @brief Ends a round, forgetting processes which did not run.
+    void end() {
+        std::swap(m_last, m_current);
+        m_current.clear();
+        for (auto it = m_victims.begin(); it != m_victims.end(); )
+            it = m_last.count(*it) ? std::next(it) : m_victims.erase(it);
+    }
+
+    //! @brief Messages whose process was not admitted in the current round.
+    std::vector<message> const& dropped() const {
+        return m_dropped;
+    }
+
+    //! @brief Number of processes rejected in the current round.
+    size_t rejected() const {
+        return m_rejected;
+    }
+
+    //! @brief Number of processes evicted in the current round.
+    size_t evicted() const {
+        return m_evicted;
+    }
+
+  private:
+    //! @brief Notes that the process of a message did not run.
+    bool drop(message const& m) {
+        m_dropped.push_back(m);
+        return false;
+    }
+
+    //! @brief Notes that the process of a message is refused.
+    bool refuse(message const& m) {
+        m_refused.insert(m);
+        return drop(m);
+    }
+
+    //! @brief Maximum number of processes (0 for no maximum).
+    size_t m_cap = 0;
+    //! @brief Maximum age of processes (0 for no maximum).
+    times_t m_ttl = 0;
+    //! @brief Current time.
+    times_t m_now = 0;
+    //! @brief Number of processes run in the current round, and not to be evicted.
+    size_t m_running = 0;
+    //! @brief Number of processes rejected in the current round.
+    size_t m_rejected = 0;
+    //! @brief Number of processes evicted in the current round.
+    size_t m_evicted = 0;
+    //! @brief Processes run in the previous round.
+    message_set m_last;
+    //! @brief Processes run in the current round.
+    message_set m_current;
+    //! @brief Processes to be evicted.
+    message_set m_victims;
+    //! @brief Processes rejected or evicted.
+    message_set m_refused;
+    //! @brief Processes not run in the current round.
+    std::vector<message> m_dropped;
+};
+
+
+//! @brief Status of a process which does not run (field overload).
+inline field<bool> refused_status(field<bool> const&) {
+    return false;
+}
+
+//! @brief Status of a process which does not run (status overload).
+inline status refused_status(status) {
+    return status::external;
+}
+
+
+} // coordination
+
+} // fcpp
+
+#endif // FCPP_ADMISSION_H_
@@ -0,0 +1,278 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file benchmark.hpp
+ * @brief Microbenchmarks of the building blocks used by the case studies.
+ */
+
+#ifndef FCPP_BENCHMARK_H_
+#define FCPP_BENCHMARK_H_
+
+#include <atomic>
+#include <numeric>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/xc_processes.hpp"
+#include "lib/xc_setup.hpp"
+#include "lib/replicated.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+namespace tags {
+    //! @brief The building block benchmarked.
+    struct bench_kind {};
+
+    //! @brief The number of concurrent processes (or monitored formulas) run by every device.
+    struct bench_procs {};
+
+    //! @brief The number of UIDs contributed by every device to collected sets.
+    struct bench_set {};
+}
+
+//! @brief Building blocks which can be benchmarked.
+enum class bench_block { monotonic_distance, flex_parent, parent_collection, parent_collection_hash, rand_hood, spawn, spawn_profiler, replicate, spawn_replicate, somewhere, somewhere_all, distance_split, distance_fused, SIZE };
+
+//! @brief Names of the building blocks which can be benchmarked.
+constexpr char const* bench_names[] = {"monotonic_distance", "flex_parent", "parent_collection", "parent_collection_hash", "rand_hood", "spawn", "spawn_profiler", "replicate", "spawn_replicate", "somewhere", "somewhere_all", "distance_split", "distance_fused"};
+
+//! @brief Number of rounds run in benchmarks, across all devices.
+std::atomic<size_t> bench_rounds{0};
+
+//! @brief Number of messages sent in benchmarks, across all devices.
+std::atomic<size_t> bench_sends{0};
+
+//! @brief Number of bytes sent in benchmarks, across all devices.
+std::atomic<size_t> bench_bytes{0};
+
+
+//! @brief Runs a given number of concurrent processes through the field<bool> overload of spawn.
+FUN void spawn_benchmark(ARGS, size_t procs) { CODE
+    std::vector<size_t> keys(procs);
+    std::iota(keys.begin(), keys.end(), 0);
+    spawn(CALL, [&](size_t const& k){
+        return make_tuple(k, field<bool>(true));
+    }, keys);
+}
+//! @brief Export list for spawn_benchmark.
+FUN_EXPORT spawn_benchmark_t = export_list<spawn_t<size_t, bool>, field<bool>>;
+
+
+//! @brief Runs a given number of concurrent processes through spawn_profiler.
+FUN void spawn_profiler_benchmark(ARGS, size_t procs) { CODE
+    std::vector<message> keys;
+    for (size_t k = 0; k < procs; ++k)
+        keys.emplace_back(device_t(k), device_t(k+1), times_t(0), real_t(k) / procs);
+    spawn_profiler(CALL, tags::spherical<xc>{}, [&](message const&, real_t, size_stream&){
+        return make_tuple(node.current_time(), field<bool>(true));
+    }, keys, 0, false);
+}
+//! @brief Export list for spawn_profiler_benchmark.
+FUN_EXPORT spawn_profiler_benchmark_t = export_list<spawn_profiler_t>;
+
+
+//! @brief Number of replicas in replicate benchmarks.
+constexpr size_t bench_replicas = 4;
+
+//! @brief Monitors a given number of formulas through separate somewhere calls.
+FUN void somewhere_benchmark(ARGS, size_t formulas) { CODE
+    for (size_t k = 0; k < formulas; ++k) split(CALL, k, [&](){
+        return somewhere(CALL, (node.uid + k) % 16 == 0, bench_replicas, bench_replicas - 1, 1);
+    });
+}
+//! @brief Export list for somewhere_benchmark.
+FUN_EXPORT somewhere_benchmark_t = export_list<somewhere_t>;
+
+//! @brief Monitors N formulas through a single somewhere call.
+template <size_t N, typename node_t>
+void somewhere_all_benchmark(ARGS) { CODE
+    std::array<bool, N> f;
+    for (size_t k = 0; k < N; ++k) f[k] = (node.uid + k) % 16 == 0;
+    somewhere(CALL, f, bench_replicas, bench_replicas - 1, 1);
+}
+//! @brief Export list for somewhere_all_benchmark.
+FUN_EXPORT somewhere_all_benchmark_t = export_list<somewhere_all_t<1>, somewhere_all_t<4>, somewhere_all_t<16>, somewhere_all_t<64>, somewhere_all_t<256>>;
+
+
+//! @brief Runs a given number of processes estimating distances in space and time through separate or fused exchanges.
+FUN void distance_benchmark(ARGS, size_t procs, bool fused) { CODE
+    std::vector<size_t> keys(procs);
+    std::iota(keys.begin(), keys.end(), 0);
+    spawn(CALL, [&](size_t const& k){
+        bool source = node.uid == k;
+        if (fused) monotonic_distance(CALL, source, node.nbr_dist(), node.nbr_lag());
+        else {
+            monotonic_distance(CALL, source, node.nbr_dist());
+            monotonic_distance(CALL, source, node.nbr_lag());
+        }
+        return make_tuple(k, true);
+    }, keys);
+}
+//! @brief Export list for distance_benchmark.
+FUN_EXPORT distance_benchmark_t = export_list<spawn_t<size_t, bool>, monotonic_distance_t, monotonic_distances_t<2>>;
+
+
+//! @brief Runs a round of a given building block.
+FUN void bench_round(ARGS, bench_block b, size_t procs, size_t set_size) { CODE
+    bool source = node.uid == 0;
+    switch (b) {
+        case bench_block::monotonic_distance:
+            monotonic_distance(CALL, source, node.nbr_dist());
+            break;
+        case bench_block::flex_parent:
+            flex_parent(CALL, source, comm);
+            break;
+        case bench_block::parent_collection: {
+            // synthetic parents: the neighbour with lowest UID
+            device_t parent = min_hood(CALL, node.nbr_uid());
+#ifdef INTERVAL
+            interval_labelling(CALL, parent);
+#else
+            set_t s;
+            for (size_t k = 0; k < set_size; ++k) s.insert(device_t(node.uid * set_size + k));
+            inplace_parent_collection(CALL, parent, s, [](set_t& x, set_t const& y){
+                merge_routes(x, y);
+            });
+#endif
+            break;
+        }
+        case bench_block::parent_collection_hash: {
+            // hash sets collected by copy, as a baseline for the routing set in use
+            using hash_t = std::unordered_set<device_t>;
+            device_t parent = min_hood(CALL, node.nbr_uid());
+            hash_t s;
+            for (size_t k = 0; k < set_size; ++k) s.insert(device_t(node.uid * set_size + k));
+            parent_collection(CALL, parent, s, [](hash_t x, hash_t const& y){
+                merge_routes(x, y);
+                return x;
+            });
+            break;
+        }
+        case bench_block::rand_hood: {
+            auto d = dist_distr();
+            min_hood(CALL, rand_hood(CALL, d));
+            break;
+        }
+        case bench_block::spawn:
+            spawn_benchmark(CALL, procs);
+            break;
+        case bench_block::spawn_profiler:
+            spawn_profiler_benchmark(CALL, procs);
+            break;
+        case bench_block::replicate:
+            replicate(CALL, [&](){
+                return logic::EP(CALL, source);
+            }, bench_replicas, 1);
+            break;
+        case bench_block::spawn_replicate:
+            spawn_replicate(CALL, [&](){
+                return logic::EP(CALL, source);
+            }, bench_replicas, 1);
+            break;
+        case bench_block::somewhere:
+            somewhere_benchmark(CALL, procs);
+            break;
+        case bench_block::somewhere_all:
+            switch (procs) {
+                case 1:   somewhere_all_benchmark<1>(CALL);   break;
+                case 4:   somewhere_all_benchmark<4>(CALL);   break;
+                case 16:  somewhere_all_benchmark<16>(CALL);  break;
+                case 64:  somewhere_all_benchmark<64>(CALL);  break;
+                case 256: somewhere_all_benchmark<256>(CALL); break;
+            }
+            break;
+        case bench_block::distance_split:
+            distance_benchmark(CALL, procs, false);
+            break;
+        case bench_block::distance_fused:
+            distance_benchmark(CALL, procs, true);
+            break;
+        default:
+            break;
+    }
+}
+//! @brief Export list for bench_round.
+FUN_EXPORT bench_round_t = export_list<monotonic_distance_t, flex_parent_t, inplace_parent_collection_t<set_t>, parent_collection_t<std::unordered_set<device_t>>, interval_labelling_t, spawn_benchmark_t, spawn_profiler_benchmark_t, replicate_t, spawn_replicate_t, past_ctl_t, somewhere_benchmark_t, somewhere_all_benchmark_t, distance_benchmark_t>;
+
+
+//! @brief Main function of the benchmarks.
+struct bench_main {
+    //! @brief Runs a round of the benchmarked function.
+    template <typename node_t>
+    void operator()(node_t& node, times_t) {
+        using namespace tags;
+        // size of the message sent by the device at the end of its previous round (none before the first)
+        if (size_t s = node.msg_size()) {
+            bench_bytes += s;
+            ++bench_sends;
+        }
+        bench_round(node, 0, bench_block(node.storage(bench_kind{})), node.storage(bench_procs{}), node.storage(bench_set{}));
+        ++bench_rounds;
+    }
+};
+//! @brief Exports for the main function of the benchmarks.
+FUN_EXPORT bench_main_t = export_list<bench_round_t>;
+
+
+} // coordination
+
+
+//! @brief Namespace for component options.
+namespace option {
+
+//! @brief End of simulated time in benchmarks.
+constexpr size_t bench_end = 20;
+
+//! @brief The simulation options for benchmarks.
+DECLARE_OPTIONS(bench_list,
+    parallel<false>,     // no multithreading on node rounds
+    synchronised<false>, // optimise for asynchronous networks
+    message_size<true>,  // measure the size of the messages sent by devices
+    program<coordination::bench_main>,   // program to be run (refers to bench_main above)
+    exports<coordination::bench_main_t>, // export type list (types used in messages)
+    retain<metric::retain<2>>, // retain time for messages
+    round_schedule<sequence::periodic_n<1, 0, 1, bench_end>>, // one round every second
+    spawn_schedule<sequence::multiple<i<devices, size_t>, n<0>>>, // the sequence generator of node creation events on the network
+    // the basic contents of the node storage
+    tuple_store<
+        bench_kind,                     size_t,
+        bench_procs,                    size_t,
+        bench_set,                      size_t,
+        proc_cap,                       size_t,
+        proc_ttl,                       double,
+        eviction,                       size_t,
+#ifndef HEADLESS
+        proc_data,                      std::vector<color>,
+        node_color,                     color,
+        left_color,                     color,
+        right_color,                    color,
+        node_size,                      double,
+#endif
+        proc_count,                     int
+    >,
+    // storage used by spawn_profiler
+    test_store_t<spherical, xc>,
+    // data initialisation
+    init<
+        x,                  rectangle_d,
+        bench_kind,         i<bench_kind, size_t>,
+        bench_procs,        i<bench_procs, size_t>,
+        bench_set,          i<bench_set, size_t>
+    >,
+    dimension<dim>, // dimensionality of the space
+    connector<connect::fixed<comm, 1, dim>> // connection allowed within a fixed comm range
+);
+
+}
+
+
+}
+
+#endif // FCPP_BENCHMARK_H_
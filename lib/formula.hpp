@@ -0,0 +1,288 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file formula.hpp
+ * @brief Past-CTL formulas as expression templates, evaluated through a single fused exchange.
+ *
+ * A formula such as `EP(c and not AP(d))` is built as a tree of types, where every
+ * temporal operator is assigned a bit slot at compile time. Evaluating the formula
+ * computes every operator bottom-up from the values of all slots in the previous round
+ * of the device and its neighbours, which are exchanged packed in a single `nbr`.
+ */
+
+#ifndef FCPP_FORMULA_H_
+#define FCPP_FORMULA_H_
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "lib/coordination/time.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Namespace containing Past-CTL formulas as expression templates.
+namespace formula {
+
+
+//! @brief Values of N slots, packed in 64-bit words.
+template <size_t N>
+using slot_bits = std::array<uint64_t, (N + 63) / 64>;
+
+//! @brief Reads a slot.
+template <size_t M>
+inline bool get_slot(std::array<uint64_t, M> const& b, size_t s) {
+    return (b[s / 64] >> (s % 64)) & 1;
+}
+
+//! @brief Writes a slot.
+template <size_t M>
+inline void set_slot(std::array<uint64_t, M>& b, size_t s, bool v) {
+    b[s / 64] = (b[s / 64] & ~(uint64_t(1) << (s % 64))) | (uint64_t(v) << (s % 64));
+}
+
+
+//! @brief Base class of formulas.
+struct expr {};
+
+//! @brief Whether a type is a formula.
+template <typename T>
+constexpr bool is_expr = std::is_base_of<expr, std::decay_t<T>>::value;
+
+
+//! @brief Atomic proposition, holding its value in the current round.
+struct atom : expr {
+    //! @brief Number of slots.
+    static constexpr size_t slots = 0;
+
+    //! @brief Member constructor.
+    atom(bool v) : value(v) {}
+
+    //! @brief Sets the initial values of the slots.
+    template <typename S>
+    void init(S&, size_t) const {}
+
+    //! @brief Evaluates the formula given the slots of the previous round, writing those of the current round.
+    template <typename node_t, typename S>
+    bool eval(ARGS, field<S> const&, S&, size_t) const {
+        return value;
+    }
+
+    //! @brief The value of the proposition.
+    bool value;
+};
+
+//! @brief Turns a boolean into an atomic proposition (formulas are left untouched).
+inline atom lift(bool v) {
+    return {v};
+}
+
+//! @brief Turns a boolean into an atomic proposition (formulas are left untouched).
+template <typename E, typename = std::enable_if_t<is_expr<E>>>
+E const& lift(E const& e) {
+    return e;
+}
+
+//! @brief The formula type corresponding to a boolean or formula type.
+template <typename T>
+using lift_t = std::decay_t<decltype(lift(std::declval<T>()))>;
+
+
+//! @brief Negation.
+template <typename A>
+struct negation : expr {
+    static constexpr size_t slots = A::slots;
+
+    negation(A const& a) : a(a) {}
+
+    template <typename S>
+    void init(S& b, size_t o) const {
+        a.init(b, o);
+    }
+
+    template <typename node_t, typename S>
+    bool eval(ARGS, field<S> const& prev, S& next, size_t o) const {
+        return not a.eval(node, call_point, prev, next, o);
+    }
+
+    A a;
+};
+
+//! @brief Binary boolean connective (both arguments are always evaluated, so that every slot is written).
+template <typename A, typename B, bool conj>
+struct connective : expr {
+    static constexpr size_t slots = A::slots + B::slots;
+
+    connective(A const& a, B const& b) : a(a), b(b) {}
+
+    template <typename S>
+    void init(S& v, size_t o) const {
+        a.init(v, o);
+        b.init(v, o + A::slots);
+    }
+
+    template <typename node_t, typename S>
+    bool eval(ARGS, field<S> const& prev, S& next, size_t o) const {
+        bool x = a.eval(node, call_point, prev, next, o);
+        bool y = b.eval(node, call_point, prev, next, o + A::slots);
+        return conj ? x and y : x or y;
+    }
+
+    A a;
+    B b;
+};
+
+
+//! @brief Temporal operators.
+enum class op { Y, P, H, EY, AY, EP, AP, EH, AH, ES, AS };
+
+/**
+ * @brief Temporal operator on one or two arguments, owning one slot after those of its arguments.
+ *
+ * Operators on the past of the device (Y, P, H) read the previous value of their slot in the
+ * device, while the others combine it across the device and its neighbours. The slot holds the
+ * value of the argument for yesterday operators, and the value of the operator itself otherwise.
+ */
+template <op o, typename A, typename B = atom>
+struct temporal : expr {
+    static constexpr size_t slots = A::slots + B::slots + 1;
+
+    temporal(A const& a, B const& b = atom(false)) : a(a), b(b) {}
+
+    template <typename S>
+    void init(S& v, size_t off) const {
+        a.init(v, off);
+        b.init(v, off + A::slots);
+        // historically operators hold vacuously before the first round
+        set_slot(v, off + A::slots + B::slots, o == op::H or o == op::EH or o == op::AH);
+    }
+
+    template <typename node_t, typename S>
+    bool eval(ARGS, field<S> const& prev, S& next, size_t off) const {
+        bool x = a.eval(node, call_point, prev, next, off);
+        bool y = b.eval(node, call_point, prev, next, off + A::slots);
+        size_t s = off + A::slots + B::slots;
+        bool own = get_slot(self(CALL, prev), s);
+        field<bool> nb = map_hood([&](S const& v){
+            return get_slot(v, s);
+        }, prev);
+        bool r;
+        switch (o) {
+            case op::Y:  r = own;                             break;
+            case op::P:  r = x or own;                        break;
+            case op::H:  r = x and own;                       break;
+            case op::EY: r = any_hood(CALL, nb);              break;
+            case op::AY: r = all_hood(CALL, nb);              break;
+            case op::EP: r = x or any_hood(CALL, nb);         break;
+            case op::AP: r = x or all_hood(CALL, nb);         break;
+            case op::EH: r = x and any_hood(CALL, nb);        break;
+            case op::AH: r = x and all_hood(CALL, nb);        break;
+            case op::ES: r = y or (x and any_hood(CALL, nb)); break;
+            case op::AS: r = y or (x and all_hood(CALL, nb)); break;
+        }
+        bool yesterday = o == op::Y or o == op::EY or o == op::AY;
+        set_slot(next, s, yesterday ? x : r);
+        return r;
+    }
+
+    A a;
+    B b;
+};
+
+
+//! @brief Negation of a formula.
+template <typename A, typename = std::enable_if_t<is_expr<A>>>
+negation<A> operator!(A const& a) {
+    return {a};
+}
+
+//! @brief Conjunction of formulas (at least one of which is not a boolean).
+template <typename A, typename B, typename = std::enable_if_t<is_expr<A> or is_expr<B>>>
+connective<lift_t<A>, lift_t<B>, true> operator&&(A const& a, B const& b) {
+    return {lift(a), lift(b)};
+}
+
+//! @brief Disjunction of formulas (at least one of which is not a boolean).
+template <typename A, typename B, typename = std::enable_if_t<is_expr<A> or is_expr<B>>>
+connective<lift_t<A>, lift_t<B>, false> operator||(A const& a, B const& b) {
+    return {lift(a), lift(b)};
+}
+
+//! @brief Defines a unary temporal operator.
+#define FCPP_FORMULA_UNARY(O)                       \
+template <typename A>                               \
+temporal<op::O, lift_t<A>> O(A const& a) {          \
+    return {lift(a)};                               \
+}
+
+//! @brief Defines a binary temporal operator.
+#define FCPP_FORMULA_BINARY(O)                                  \
+template <typename A, typename B>                               \
+temporal<op::O, lift_t<A>, lift_t<B>> O(A const& a, B const& b) {  \
+    return {lift(a), lift(b)};                                  \
+}
+
+//! @brief Yesterday: the formula held in the previous round of the device.
+FCPP_FORMULA_UNARY(Y)
+//! @brief Previously: the formula held in some past round of the device.
+FCPP_FORMULA_UNARY(P)
+//! @brief Historically: the formula held in every past round of the device.
+FCPP_FORMULA_UNARY(H)
+//! @brief The formula held in the previous round of the device or some neighbour.
+FCPP_FORMULA_UNARY(EY)
+//! @brief The formula held in the previous round of the device and every neighbour.
+FCPP_FORMULA_UNARY(AY)
+//! @brief The formula held in some past event.
+FCPP_FORMULA_UNARY(EP)
+//! @brief The formula held along every path of past events.
+FCPP_FORMULA_UNARY(AP)
+//! @brief The formula held in every event of some path of past events.
+FCPP_FORMULA_UNARY(EH)
+//! @brief The formula held in every past event.
+FCPP_FORMULA_UNARY(AH)
+//! @brief The first formula held since the second held, along some path of past events.
+FCPP_FORMULA_BINARY(ES)
+//! @brief The first formula held since the second held, along every path of past events.
+FCPP_FORMULA_BINARY(AS)
+
+#undef FCPP_FORMULA_UNARY
+#undef FCPP_FORMULA_BINARY
+
+
+//! @brief The type exported by a formula type.
+template <typename E>
+using slots_t = slot_bits<lift_t<E>::slots>;
+
+//! @brief Evaluates a formula (or boolean), exchanging the slots of all its temporal operators at once.
+GEN(E) bool eval(ARGS, E const& e) { CODE
+    using F = lift_t<E>;
+    constexpr size_t n = F::slots;
+    F const& f = lift(e);
+    slot_bits<n> init{};
+    f.init(init, 0);
+    bool r;
+    nbr(CALL, init, [&](field<slot_bits<n>> prev){
+        slot_bits<n> next{};
+        r = f.eval(CALL, prev, next, 0);
+        return next;
+    });
+    return r;
+}
+//! @brief Export list for eval on a formula type.
+GEN_EXPORT(E) eval_t = export_list<slots_t<E>>;
+
+
+} // formula
+
+} // coordination
+
+} // fcpp
+
+#endif // FCPP_FORMULA_H_
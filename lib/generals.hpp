@@ -8,12 +8,25 @@
 #ifndef FCPP_GENERALS_H_
 #define FCPP_GENERALS_H_
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
 #include "lib/beautify.hpp"
+#include "lib/common/serialize.hpp"
 #include "lib/coordination.hpp"
 #include "lib/data.hpp"
+#include "lib/simd.hpp"
 
 //! @brief Types of messages
-enum class msgtype {
+enum class msgtype : uint8_t {
     NONE,    // irrelevant
     DISCO,   // service discovery message
     OFFER,   // offer of service message
@@ -22,57 +35,219 @@ enum class msgtype {
     DATAEND  // end of data
 };
 
-//! @brief Struct representing a message.
+/**
+ * @brief Struct representing a message.
+ *
+ * Messages are serialised in a packed wire format: a header byte holding the format version
+ * (high nibble) and message type (low nibble), sender and receiver UIDs as varints, the full
+ * timestamp and data, and the service type byte.
+ */
 struct message {
-    //! @brief Sender UID.
-    fcpp::device_t from;
-    //! @brief Receiver UID.
-    fcpp::device_t to;
+    //! @brief Version of the wire format.
+    static constexpr uint8_t wire_version = 1;
+
     //! @brief Creation timestamp.
     fcpp::times_t time;
     //! @brief Data content.
     fcpp::real_t data;
+    //! @brief Sender UID.
+    fcpp::device_t from;
+    //! @brief Receiver UID.
+    fcpp::device_t to;
+    //! @brief Service type.
+    uint8_t svc_type;
     //! @brief Message type.
     msgtype type;
-    //! @brief Service type.
-    size_t svc_type;
 
     //! @brief Empty constructor.
     message() = default;
 
     //! @brief Member constructor for messages with NONE type.
     message(fcpp::device_t from, fcpp::device_t to, fcpp::times_t time, fcpp::real_t data) :
-        from(from), to(to), time(time), data(data), type(msgtype::NONE), svc_type(0) {}
+        time(time), data(data), from(from), to(to), svc_type(0), type(msgtype::NONE) {}
 
     //! @brief Member constructor.
-    message(fcpp::device_t from, fcpp::device_t to, fcpp::times_t time, fcpp::real_t data, msgtype mtype, size_t stype) : 
-        from(from), to(to), time(time), data(data), type(mtype), svc_type(stype) {}
+    message(fcpp::device_t from, fcpp::device_t to, fcpp::times_t time, fcpp::real_t data, msgtype mtype, uint8_t stype) : 
+        time(time), data(data), from(from), to(to), svc_type(stype), type(mtype) {}
 
     //! @brief Equality operator.
     bool operator==(message const& m) const {
-        return from == m.from and to == m.to and time == m.time and data == m.data;
+        return from == m.from and to == m.to and time == m.time and data == m.data and type == m.type and svc_type == m.svc_type;
     }
 
-    //! @brief Hash computation.
+    //! @brief Hash computation, mixing every bit of sender, receiver, timestamp and data.
     size_t hash() const {
-        constexpr size_t offs = sizeof(size_t)*CHAR_BIT/3;
-        return (size_t(time) << (2*offs)) | (size_t(from) << (offs)) | size_t(to);
+        uint64_t h = mix((uint64_t(from) << 32) ^ uint64_t(to));
+        h = mix(h ^ bits(time));
+        return mix(h ^ bits(data));
     }
 
     //! @brief Serialises the content from/to a given input/output stream.
     template <typename S>
     S& serialize(S& s) {
-        return s & from & to & time & data;
+        return serialize(s, std::is_same<S, fcpp::common::isstream>{});
     }
 
     //! @brief Serialises the content from/to a given input/output stream (const overload).
     template <typename S>
     S& serialize(S& s) const {
-        return s << from << to << time << data;
+        s << uint8_t((wire_version << 4) | uint8_t(type));
+        write_varint(s, from);
+        write_varint(s, to);
+        return s << time << data << svc_type;
+    }
+
+  private:
+    //! @brief Deserialises the content from an input stream.
+    template <typename S>
+    S& serialize(S& s, std::true_type) {
+        uint8_t head;
+        s >> head;
+        assert((head >> 4) == wire_version);
+        type = msgtype(head & 15);
+        from = read_varint(s);
+        to = read_varint(s);
+        return s >> time >> data >> svc_type;
+    }
+
+    //! @brief Serialises the content to an output stream.
+    template <typename S>
+    S& serialize(S& s, std::false_type) const {
+        return serialize(s);
+    }
+
+    //! @brief Writes an UID as a varint (7 bits per byte, lowest first).
+    template <typename S>
+    static void write_varint(S& s, fcpp::device_t x) {
+        for (; x >= 128; x >>= 7) s << uint8_t(x | 128);
+        s << uint8_t(x);
+    }
+
+    //! @brief Maximum number of bytes in a varint.
+    static constexpr size_t max_varint_bytes = (std::numeric_limits<fcpp::device_t>::digits + 6) / 7;
+
+    //! @brief Reads an UID written as a varint (at most `max_varint_bytes` bytes are read).
+    template <typename S>
+    static fcpp::device_t read_varint(S& s) {
+        fcpp::device_t x = 0;
+        uint8_t b = 128;
+        for (size_t n = 0; n < max_varint_bytes and (b & 128); ++n) {
+            s >> b;
+            x |= fcpp::device_t(b & 127) << (7 * n);
+        }
+        // malformed input: the varint goes on past the width of an UID
+        assert((b & 128) == 0);
+        return x;
+    }
+
+    //! @brief Bit representation of a floating-point value.
+    template <typename T>
+    static uint64_t bits(T x) {
+        static_assert(sizeof(T) <= sizeof(uint64_t), "unsupported floating-point type");
+        uint64_t b = 0;
+        std::memcpy(&b, &x, sizeof(T));
+        return b;
+    }
+
+    //! @brief Finaliser of SplitMix64.
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
     }
 };
 
 
+/**
+ * @brief Log of delivered messages within a sliding time window.
+ *
+ * Messages are identified by their hash in an open-addressing table with linear probing.
+ * Entries logged before the time window are reused as free slots on insertion, and skipped
+ * while searching. Logging a message already in the window refreshes its entry, so that a
+ * message keeps being recognised while it keeps arriving. If every slot is in the window,
+ * the table doubles its size, so that it grows with the messages delivered within the
+ * window (the load times the window) and no entry in the window is ever overwritten.
+ *
+ * Since every slot on the probe sequence of an entry was in the window when the entry was
+ * logged (or refreshed), slots logged before twice the window (or never used) lie on the
+ * probe sequence of no entry in the window, and end every search. For this reason, a
+ * refreshed entry is moved to the first reusable slot on its probe sequence (if any).
+ *
+ * @param capacity The initial number of slots in the table (a power of two).
+ */
+template <size_t capacity>
+class delivery_log {
+    static_assert(capacity > 0 and (capacity & (capacity - 1)) == 0, "the capacity of a delivery log must be a power of two");
+
+  public:
+    //! @brief Empty constructor.
+    delivery_log() : m_slots(capacity, empty()) {}
+
+    /**
+     * @brief Logs a message, if not already logged within the time window.
+     *
+     * @param m The message to be logged.
+     * @param now The current time.
+     * @param horizon The width of the time window.
+     * @return Whether the message was not already logged.
+     */
+    bool insert(message const& m, fcpp::times_t now, fcpp::times_t horizon) {
+        size_t h = m.hash();
+        fcpp::times_t start = now - horizon;
+        size_t size = m_slots.size(), free = size;
+        for (size_t n = 0, i = h & (size - 1); n < size; ++n, i = (i + 1) & (size - 1)) {
+            slot& s = m_slots[i];
+            if (s.time >= start) {
+                if (s.key == h) {
+                    // the old slot keeps its time, since it may lie on the probe sequence of other entries
+                    (free < size ? m_slots[free] : s) = {h, now};
+                    return false;
+                }
+            } else {
+                if (free == size) free = i;
+                if (s.time < start - horizon) break;
+            }
+        }
+        if (free == size) {
+            grow(start);
+            return insert(m, now, horizon);
+        }
+        m_slots[free] = {h, now};
+        return true;
+    }
+
+  private:
+    //! @brief A slot of the table.
+    struct slot {
+        //! @brief Hash of the message.
+        size_t key;
+        //! @brief Time at which the message was logged.
+        fcpp::times_t time;
+    };
+
+    //! @brief A slot never used.
+    static slot empty() {
+        return {0, -std::numeric_limits<fcpp::times_t>::infinity()};
+    }
+
+    //! @brief Doubles the size of the table, keeping the entries logged after `start`.
+    void grow(fcpp::times_t start) {
+        std::vector<slot> old(2 * m_slots.size(), empty());
+        std::swap(old, m_slots);
+        size_t size = m_slots.size();
+        for (slot const& s : old) if (s.time >= start) {
+            size_t i = s.key & (size - 1);
+            while (m_slots[i].time >= start) i = (i + 1) & (size - 1);
+            m_slots[i] = s;
+        }
+    }
+
+    //! @brief The table of slots.
+    std::vector<slot> m_slots;
+};
+
+
 namespace std {
     //! @brief Hasher object for the message struct.
     template <>
@@ -90,6 +265,96 @@ namespace std {
  */
 namespace fcpp {
 
+//! @cond INTERNAL
+namespace details {
+    //! @brief Tag type ranking overloads by priority.
+    template <size_t n>
+    struct overload_priority : overload_priority<n-1> {};
+
+    //! @brief Tag type ranking overloads by priority (lowest priority).
+    template <>
+    struct overload_priority<0> {};
+}
+//! @endcond
+
+/**
+ * @brief Output stream computing the size of serialised data, without storing it.
+ *
+ * Values providing a `serialize` member are measured through it, fields and containers
+ * element by element (after their size), and other trivially copyable values by their
+ * size in memory.
+ */
+class size_stream {
+    //! @brief Priority of overloads when measuring values.
+    template <size_t n>
+    using priority = details::overload_priority<n>;
+
+  public:
+    //! @brief Empty constructor.
+    size_stream() : m_size(0) {}
+
+    //! @brief Size of the data written so far.
+    size_t size() const {
+        return m_size;
+    }
+
+    //! @brief Writes a value.
+    template <typename T>
+    size_stream& operator<<(T const& x) {
+        write(x, priority<3>{});
+        return *this;
+    }
+
+    //! @brief Writes a value.
+    template <typename T>
+    size_stream& operator&(T const& x) {
+        return *this << x;
+    }
+
+  private:
+    //! @brief Writes a value with a serialize member.
+    template <typename T>
+    auto write(T const& x, priority<3>) -> decltype(x.serialize(*this), void()) {
+        x.serialize(*this);
+    }
+
+    //! @brief Writes a field.
+    template <typename T>
+    void write(field<T> const& x, priority<2>) {
+        m_size += sizeof(size_t) + details::get_ids(x).size() * sizeof(device_t);
+        for (auto const& v : details::get_vals(x)) *this << v;
+    }
+
+    //! @brief Writes a tuple.
+    template <typename... Ts>
+    void write(tuple<Ts...> const& x, priority<2>) {
+        write_tuple(x, std::index_sequence_for<Ts...>{});
+    }
+
+    //! @brief Writes a container.
+    template <typename T>
+    auto write(T const& x, priority<1>) -> decltype(x.size(), x.begin(), x.end(), void()) {
+        m_size += sizeof(size_t);
+        for (auto const& v : x) *this << v;
+    }
+
+    //! @brief Writes a trivially copyable value.
+    template <typename T>
+    std::enable_if_t<std::is_trivially_copyable<T>::value> write(T const&, priority<0>) {
+        m_size += sizeof(T);
+    }
+
+    //! @brief Writes the elements of a tuple.
+    template <typename T, size_t... is>
+    void write_tuple(T const& x, std::index_sequence<is...>) {
+        int expand[] = {0, (*this << get<is>(x), 0)...};
+        (void)expand;
+    }
+
+    //! @brief Size of the data written so far.
+    size_t m_size;
+};
+
 //! @brief Namespace containing the libraries of coordination routines.
 namespace coordination {
 
@@ -141,15 +406,42 @@ namespace tags {
     template <typename T>
     struct delivery_count {};
 
+    //! @brief The number of processes run by the node in the current round.
+    template <typename T>
+    struct peak_proc {};
+
+    //! @brief Processes admitted by the node.
+    template <typename T>
+    struct admission {};
+
+    //! @brief Total number of processes rejected by the node.
+    template <typename T>
+    struct rejected_count {};
+
+    //! @brief Total number of processes evicted by the node.
+    template <typename T>
+    struct evicted_count {};
+
     //! @brief Total number of repeated deliveries.
     template <typename T>
     struct repeat_count {};
 
+    //! @brief Log of messages recently delivered to the node.
+    template <typename T>
+    struct delivered {};
+
 
     //! @brief Average time of first delivery.
     template <typename T>
     struct avg_delay {};
 
+    //! @brief First deliveries per unit of time (instant measure).
+    template <typename T>
+    struct delivery_rate {};
+
+    //! @brief Messages generated per unit of time (instant measure).
+    struct offered_load {};
+
     //! @brief Total active processes per unit of time (instant measure).
     template <typename T>
     struct avg_proc {};
@@ -158,22 +450,39 @@ namespace tags {
     template <typename T>
     struct avgtot_proc {};
 
-    //! @brief The maximum size of messages exchanged for a certain process.
+    //! @brief The maximum size of the export of an instance of a certain process.
     template <typename T>
     struct max_msg_size {};
 
-    //! @brief The total size of messages exchanged for a certain process.
+    //! @brief The total size of the exports of instances of a certain process.
     template <typename T>
     struct tot_msg_size {};
 
-    //! @brief Total message size of processes per unit of time (instant measure).
+    //! @brief Total size of exports of processes per unit of time (instant measure).
     template <typename T>
     struct avg_size {};
 
-    //! @brief Total message size of processes per unit of time (averaged measure).
+    //! @brief Total size of exports of processes per unit of time (averaged measure).
     template <typename T>
     struct avgtot_size {};
 
+    //! @brief The wall-clock time (in microseconds) spent by a device in a certain section of the program.
+    template <typename T>
+    struct prof_time {};
+
+    //! @brief Average wall-clock time spent in a certain section of the program per device and unit of time.
+    template <typename T>
+    struct avg_time {};
+
+    //! @brief Program section moving the device.
+    struct prof_walk {};
+
+    //! @brief Program section building the spanning tree.
+    struct prof_tree {};
+
+    //! @brief Program section collecting routing sets along the spanning tree.
+    struct prof_routes {};
+
 
     //! @brief The variance of round timing in the network.
     struct tvar {};
@@ -199,9 +508,57 @@ namespace tags {
     //! @brief The estimated multi-path information speed factor.
     struct infospeed {};
 
+    //! @brief Serialized size of the routing set of the current node.
+    struct route_size {};
+
+    //! @brief Fraction of devices not in the subtree wrongly matched by the routing set.
+    struct route_fpr {};
+
+    //! @brief Serialized size of the data exported to share the routing set with neighbours.
+    struct route_sent {};
+
+    //! @brief DFS label of the current node in the routing tree.
+    struct dfs_label {};
+
+    //! @brief The load of messages offered to the network (per unit of time).
+    struct load {};
+
+    //! @brief The increase of the load across the generation window, relative to the initial load.
+    struct ramp {};
+
+    //! @brief The arrival process of messages.
+    struct arrivals {};
+
+    //! @brief The distribution of senders of messages.
+    struct senders {};
+
+    //! @brief The distribution of receivers of messages.
+    struct receivers {};
+
+    //! @brief The maximum number of processes run at once by a node (0 for no maximum).
+    struct proc_cap {};
+
+    //! @brief The maximum age of processes (0 for no maximum).
+    struct proc_ttl {};
+
+    //! @brief The order in which processes are evicted.
+    struct eviction {};
+
+    //! @brief The number of roots of the spanning forest.
+    struct roots {};
+
+    //! @brief Root of the tree of the current node in the spanning forest.
+    struct tree_root {};
+
     //! @brief Temporary data of active processes.
     struct proc_data {};
 
+    //! @brief Number of processes active in the current round.
+    struct proc_count {};
+
+    //! @brief Sources of the FC tree processes active in the current round.
+    struct live_sources {};
+
     //! @brief Total number of sent messages.
     struct sent_count {};
 
@@ -239,46 +596,162 @@ namespace tags {
 } // tags
 
 
+/**
+ * @brief Accumulates the wall-clock time spent in a scope into the storage of a node.
+ *
+ * @param node_t The node type.
+ * @param T      The tag of the program section (time is stored in `tags::prof_time<T>`).
+ */
+template <typename node_t, typename T>
+class scoped_timer {
+  public:
+    //! @brief Starts the timer.
+    scoped_timer(node_t& node) : m_node(node), m_start(std::chrono::steady_clock::now()) {}
+
+    //! @brief Stops the timer, storing the time elapsed.
+    ~scoped_timer() {
+        m_node.storage(tags::prof_time<T>{}) += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_start).count();
+    }
+
+  private:
+    //! @brief The node.
+    node_t& m_node;
+
+    //! @brief The starting time.
+    std::chrono::steady_clock::time_point m_start;
+};
+
+#ifdef PROFILE
+//! @brief Times the rest of the current scope as program section T.
+#define PROFILE_SCOPE(T) fcpp::coordination::scoped_timer<std::remove_reference_t<decltype(node)>, T> profile_scope_timer(node)
+#else
+//! @brief Times the rest of the current scope as program section T (disabled, define PROFILE to enable).
+#define PROFILE_SCOPE(T)
+#endif
+
+
 //! @brief Distance estimation which can only decrease over time using given metric field of relative distances.
 GEN(T) real_t monotonic_distance(ARGS, bool source, field<T> const& rd) { CODE
     return nbr(CALL, INF, [&](field<real_t> nd){
-        real_t mind = min_hood(CALL, nd + rd); // inclusive
+        real_t mind = min_sum_hood(CALL, nd, rd); // inclusive
         return source ? 0.0 : mind;
     });
 }
 //! @brief Export list for monotonic_distance.
 FUN_EXPORT monotonic_distance_t = export_list<real_t>;
 
+/**
+ * @brief Distance estimations which can only decrease over time, for multiple metric fields of relative distances.
+ *
+ * The distances in every metric are exchanged together as an array through a single `nbr`,
+ * and all minima are computed in a single pass over the neighbourhood.
+ */
+template <typename node_t, typename T, typename U, typename... Ts>
+std::array<real_t, sizeof...(Ts) + 2> monotonic_distance(ARGS, bool source, field<T> const& rd, field<U> const& re, field<Ts> const&... rs) { CODE
+    using dist_t = std::array<real_t, sizeof...(Ts) + 2>;
+    dist_t inf;
+    inf.fill(INF);
+    return nbr(CALL, inf, [&](field<dist_t> nd){
+        dist_t mind = fold_hood(CALL, [](dist_t const& x, dist_t m){
+            for (size_t i = 0; i < m.size(); ++i) m[i] = std::min(m[i], x[i]);
+            return m;
+        }, map_hood([](dist_t d, T const& x, U const& y, Ts const&... z){
+            dist_t r = {real_t(x), real_t(y), real_t(z)...};
+            for (size_t i = 0; i < d.size(); ++i) d[i] += r[i];
+            return d;
+        }, nd, rd, re, rs...)); // inclusive
+        if (source) mind.fill(0);
+        return mind;
+    });
+}
+//! @brief Export list for monotonic_distance on N metrics.
+template <size_t N>
+using monotonic_distances_t = export_list<std::array<real_t, N>>;
+
+
+//! @brief Minimum of distances through neighbours, and maximum slope information, as computed by flex_parent.
+struct flex_hood_t {
+    //! @brief The minimum distance through a neighbour, and the neighbour.
+    tuple<real_t, device_t> new_di;
+    //! @brief The maximum slope through a neighbour, with its distance and relative distance.
+    tuple<real_t, real_t, real_t> slopeinfo;
+};
+
+/**
+ * @brief Reductions over neighbours of flex_parent, given the distances of neighbours and to neighbours.
+ *
+ * Values of fields aligned to the domain are reduced as separate arrays with vectorised kernels,
+ * resolving ties in the order of the domain (i.e., by UID) as the tuple comparisons of hood
+ * operators do. The value of the device itself is replaced by `loc` and `(-INF, INF, 0)`.
+ */
+template <typename node_t>
+flex_hood_t flex_hood(ARGS, field<real_t> const& nd, field<real_t> const& dist, real_t old_d, real_t loc) {
+    if (not simd::aligned(node, nd, dist)) return {
+        min_hood(CALL, make_tuple(nd + dist, node.nbr_uid()), make_tuple(loc, node.uid)),
+        max_hood(CALL, make_tuple((old_d - nd)/dist, nd, dist), make_tuple(-INF, INF, 0))
+    };
+    std::vector<device_t> const& ids = fcpp::details::get_ids(nd);
+    real_t const* ndv = simd::values(nd);
+    real_t const* distv = simd::values(dist);
+    size_t n = ids.size();
+    size_t me = std::lower_bound(ids.begin(), ids.end(), node.uid) - ids.begin();
+    if (me < n and ids[me] != node.uid) me = n;
+    thread_local std::vector<real_t> buf;
+    buf.resize(n);
+    // minimum distance through a neighbour (first in UID order among ties)
+    simd::add(ndv, distv, buf.data(), n);
+    if (me < n) buf[me] = loc;
+    flex_hood_t r;
+    real_t new_d = simd::min(buf.data(), n);
+    size_t k = std::find(buf.begin(), buf.end(), new_d) - buf.begin();
+    r.new_di = k < n ? make_tuple(new_d, ids[k]) : make_tuple(loc, node.uid);
+    if (me == n) r.new_di = min(r.new_di, make_tuple(loc, node.uid));
+    // maximum slope through a neighbour (greatest distance and relative distance among ties)
+    simd::slope(old_d, ndv, distv, buf.data(), n);
+    if (me < n) buf[me] = -INF;
+    real_t slope = simd::max(buf.data(), n);
+    r.slopeinfo = make_tuple(-INF, INF, 0);
+    for (size_t i = 0; i < n; ++i) if (buf[i] == slope) {
+        tuple<real_t, real_t, real_t> t = i == me ? make_tuple(-INF, INF, 0) : make_tuple(slope, ndv[i], distv[i]);
+        r.slopeinfo = max(r.slopeinfo, t);
+    }
+    return r;
+}
 
-//! @brief Computes stable parents through FLEX distance estimation.
+/**
+ * @brief Computes stable parents through FLEX distance estimation.
+ *
+ * Only distances are exchanged with neighbours, while the parent is remembered by the device.
+ */
 FUN device_t flex_parent(ARGS, bool source, real_t radius) { CODE
     constexpr real_t epsilon = 0.5;
     constexpr real_t distortion = 0.1;
-    tuple<real_t, device_t> loc{source ? 0 : INF, node.uid};
-    return get<1>(nbr(CALL, loc, [&] (field<tuple<real_t, device_t>> x) {
-        field<real_t> dist = max(node.nbr_dist(), distortion*radius);
-        tuple<real_t, device_t> const& old_di = self(CALL, x);
-        real_t old_d = get<0>(old_di);
-        device_t old_i = get<1>(old_di);
-        field<real_t> nd = get<0>(x);
-        tuple<real_t, device_t> new_di = min_hood(CALL, make_tuple(nd + dist, node.nbr_uid()), loc);
-        real_t new_d = get<0>(new_di);
-        device_t new_i = get<1>(new_di);
-        tuple<real_t,real_t,real_t> slopeinfo = max_hood(CALL, make_tuple((old_d - nd)/dist, nd, dist), make_tuple(-INF, INF, 0));
-        if (old_d == new_d or new_d == 0 or
-            old_d > max(2*new_d, radius) or new_d > max(2*old_d, radius))
-            return make_tuple(new_d, new_i);
-        if (fcpp::details::self(node.nbr_dist(), old_i) == INF or get<0>(fcpp::details::self(x, old_i)) > old_d)
-            old_i = new_i;
-        if (get<0>(slopeinfo) > 1 + epsilon)
-            return make_tuple(get<1>(slopeinfo) + get<2>(slopeinfo) * (1 + epsilon), new_i);
-        if (get<0>(slopeinfo) < 1 - epsilon)
-            return make_tuple(get<1>(slopeinfo) + get<2>(slopeinfo) * (1 - epsilon), new_i);
-        return make_tuple(old_d, new_i);
-    }));
+    real_t loc = source ? 0 : INF;
+    return old(CALL, node.uid, [&](device_t old_i){
+        device_t new_i;
+        nbr(CALL, loc, [&] (field<real_t> nd) {
+            field<real_t> dist = max(node.nbr_dist(), distortion*radius);
+            real_t old_d = self(CALL, nd);
+            flex_hood_t h = flex_hood(CALL, nd, dist, old_d, loc);
+            real_t new_d = get<0>(h.new_di);
+            new_i = get<1>(h.new_di);
+            tuple<real_t,real_t,real_t> const& slopeinfo = h.slopeinfo;
+            if (old_d == new_d or new_d == 0 or
+                old_d > max(2*new_d, radius) or new_d > max(2*old_d, radius))
+                return new_d;
+            if (fcpp::details::self(node.nbr_dist(), old_i) == INF or fcpp::details::self(nd, old_i) > old_d)
+                old_i = new_i;
+            if (get<0>(slopeinfo) > 1 + epsilon)
+                return get<1>(slopeinfo) + get<2>(slopeinfo) * (1 + epsilon);
+            if (get<0>(slopeinfo) < 1 - epsilon)
+                return get<1>(slopeinfo) + get<2>(slopeinfo) * (1 - epsilon);
+            return old_d;
+        });
+        return new_i;
+    });
 }
 //! @brief Export list for flex_parent.
-FUN_EXPORT flex_parent_t = export_list<tuple<real_t, device_t>>;
+FUN_EXPORT flex_parent_t = export_list<real_t, device_t>;
 
 
 //! @brief Collects distributed data with a single-path strategy according to given parents.
@@ -291,6 +764,28 @@ T parent_collection(ARGS, device_t parent, T const& value, G&& accumulate) { COD
 //! @brief Export list for parent_collection.
 GEN_EXPORT(T) parent_collection_t = export_list<T, device_t>;
 
+/**
+ * @brief Collects distributed data with a single-path strategy according to given parents, merging in place.
+ *
+ * Values of children are merged one by one into the value of the device, through an
+ * accumulator updating its first argument, without copying them. The result is built into
+ * the value exported in the previous round, reusing its memory.
+ */
+GEN(T,G,BOUND(G, void(T&,T const&)))
+T inplace_parent_collection(ARGS, device_t parent, T const& value, G&& accumulate) { CODE
+    field<device_t> nparent = nbr(CALL, parent);
+    return nbr(CALL, T{}, [&](field<T> x){
+        T r = std::move(fcpp::details::self(x, node.uid));
+        r = value;
+        for (device_t j : fcpp::details::get_ids(node.nbr_uid()))
+            if (j != node.uid and fcpp::details::self(nparent, j) == node.uid)
+                accumulate(r, fcpp::details::self(x, j));
+        return r;
+    });
+}
+//! @brief Export list for inplace_parent_collection.
+GEN_EXPORT(T) inplace_parent_collection_t = export_list<T, device_t>;
+
 
 //! @brief Computes a field of random doubles according to a given distribution.
 GEN(T) field<real_t> rand_hood(ARGS, T&& dist) {
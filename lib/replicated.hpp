@@ -8,7 +8,16 @@
 #ifndef FCPP_REPLICATED_H_
 #define FCPP_REPLICATED_H_
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
 #include "lib/coordination/time.hpp"
+#include "lib/formula.hpp"
+#include "lib/generals.hpp"
 
 
 /**
@@ -26,6 +35,10 @@ namespace tags {
     struct now_critic_replicated {};
     struct error_SLCS {};
     struct error_replicated {};
+    struct now_critic_adaptive {};
+    struct error_adaptive {};
+    struct size_replicated {};
+    struct size_adaptive {};
     struct comm_rad {};
     struct period {};
 }
@@ -33,48 +46,311 @@ namespace tags {
 
 /**
  * Generic algorithm replicator, returning the value of the oldest
- * replica currently running.
+ * replica currently running (general spawn-based engine).
  *
  * @param fun The aggregate code to replicate (without arguments).
  * @param n   The number of replicas.
  * @param t   The interval between replica spawning.
  */
-GEN(F) auto replicate(ARGS, F fun, size_t n, times_t t) { CODE
+GEN(F) auto spawn_replicate(ARGS, F fun, size_t n, times_t t) { CODE
     size_t now = shared_clock(CALL) / t;
     auto res = spawn(CALL, [&](size_t i){
         return make_tuple(fun(), i > now - n);
     }, common::option<size_t, true>{now});
-    for (auto x : res) if (x.first > now - n) now = min(now, x.first);
-    return res[now];
+    for (auto const& x : res) if (x.first > now - n) now = min(now, x.first);
+    return res.at(now);
+}
+//! @brief Export list for spawn_replicate.
+FUN_EXPORT spawn_replicate_t = export_list<spawn_t<size_t, bool>, shared_clock_t>;
+
+
+//! @brief Maximum number of replicas supported by replicate.
+constexpr size_t max_replicas = 8;
+
+//! @brief Marker bit of the keys of warm-up replicas, disjoint from those of ring replicas (clock values).
+constexpr size_t warmup_key = size_t(1) << (8 * sizeof(size_t) - 1);
+
+//! @brief Ring of replicas: the key of the replica running in each slot, or -1 if none.
+using replica_ring = std::array<size_t, max_replicas>;
+
+/**
+ * Generic algorithm replicator, returning the value of the oldest
+ * replica currently running (ring-based engine).
+ *
+ * Replica keys always form a window of the last `n` clock values, so that replica `i`
+ * is stored in slot `i % n` of a fixed-size ring, which is all that is exported besides
+ * the replicas themselves. A new replica retires the oldest one by taking its slot.
+ * A replica is running if it is the newest, or it was running in the device or in
+ * some neighbour, matching the propagation of processes in `spawn_replicate` (since
+ * the shared clock of a device is never behind those of its neighbours, no neighbour
+ * runs replicas newer than the current one). Keys are looked up in every slot of the
+ * rings of neighbours, so that neighbours running a different number of replicas
+ * (see `adaptive_replicate`) still agree on them.
+ *
+ * @param fun     The aggregate code to replicate (without arguments).
+ * @param n       The number of replicas (at most `max_replicas`).
+ * @param t       The interval between replica spawning.
+ * @param running If given, set to the number of replicas running in the device.
+ * @param bytes   If given, set to the size of the values exported, measuring each replica by its result.
+ */
+GEN(F) auto replicate(ARGS, F fun, size_t n, times_t t, size_t* running = nullptr, size_t* bytes = nullptr) { CODE
+    assert(n <= max_replicas);
+    using result_t = std::decay_t<decltype(fun())>;
+    times_t clock = shared_clock(CALL);
+    size_t now = clock / t;
+    size_t round = old(CALL, size_t(0), [](size_t r){
+        return r + 1;
+    });
+    result_t res{};
+    bool found = false;
+    size_stream ss;
+    ss << clock << round;
+    nbr(CALL, replica_ring{}, [&](field<replica_ring> rings){
+        replica_ring ring;
+        ring.fill(-1);
+        // no replica lasts beyond the current one in the first n intervals (as in spawn_replicate)
+        if (now < n) {
+            res = split(CALL, warmup_key | (size_t(node.uid) << 32) | (round & 0xFFFFFFFF), fun);
+            ss << ring << res;
+            if (running) *running = 1;
+            return ring;
+        }
+        if (running) *running = 0;
+        for (size_t i = now - n + 1; i <= now; ++i) {
+            bool alive = i == now or any_hood(CALL, map_hood([&](replica_ring const& r){
+                return std::find(r.begin(), r.end(), i) != r.end();
+            }, rings));
+            if (not alive) continue;
+            result_t r = split(CALL, i, fun);
+            ss << r;
+            if (not found) res = r;
+            found = true;
+            ring[i % n] = i;
+            if (running) ++*running;
+        }
+        ss << ring;
+        return ring;
+    });
+    if (bytes) *bytes = ss.size();
+    return res;
 }
 //! @brief Export list for replicate.
-FUN_EXPORT replicate_t = export_list<spawn_t<size_t, bool>, shared_clock_t>;
+FUN_EXPORT replicate_t = export_list<replica_ring, size_t, shared_clock_t>;
 
 
 //! @brief Finally/somewhere operator, implemented by replicating .
-FUN bool somewhere(ARGS, bool f, size_t replicas, real_t diameter, real_t infospeed) { CODE
+FUN bool somewhere(ARGS, bool f, size_t replicas, real_t diameter, real_t infospeed, size_t* running = nullptr, size_t* bytes = nullptr) { CODE
     return replicate(CALL, [&](){
         return logic::EP(CALL, f);
-    }, replicas, diameter / infospeed / (replicas-1));
+    }, replicas, diameter / infospeed / (replicas-1), running, bytes);
 }
 //! @brief Export list for somewhere.
 FUN_EXPORT somewhere_t = export_list<replicate_t, past_ctl_t>;
 
 
-//! @brief Case study checking whether a critic event is happening.
-FUN void criticality_control(ARGS, real_t diameter, real_t infospeed) {
+//! @brief Weight of the last measure in the moving average of single-hop delays.
+constexpr real_t hop_delay_smoothing = 0.1;
+
+/**
+ * @brief Estimated time for information to cross a network of given diameter (in hops).
+ *
+ * The single-hop delay is measured as the moving average of the lag of neighbour messages,
+ * and the resulting estimates are agreed upon by gossiping their maximum, fading at unit rate
+ * so that the agreement follows estimates which decrease over time.
+ */
+FUN real_t propagation_time(ARGS, real_t diameter, size_t* bytes = nullptr) { CODE
+    size_t nbrs = count_hood(CALL) - 1;
+    real_t lag = nbrs ? sum_hood(CALL, node.nbr_lag(), times_t(0)) / nbrs : 0;
+    real_t delay = old(CALL, lag, [&](real_t d){
+        // isolated devices keep their last estimate
+        return nbrs ? d + (lag - d) * hop_delay_smoothing : d;
+    });
+    real_t local = diameter * delay;
+    real_t dt = node.current_time() - node.previous_time();
+    if (bytes) {
+        size_stream s;
+        s << delay << local;
+        *bytes = s.size();
+    }
+    return nbr(CALL, local, [&](field<real_t> x){
+        return max(local, max_hood(CALL, x) - dt);
+    });
+}
+//! @brief Export list for propagation_time.
+FUN_EXPORT propagation_time_t = export_list<real_t>;
+
+//! @brief Smallest power of two not below a positive value.
+inline real_t pow2_ceil(real_t x) {
+    return std::exp2(std::ceil(std::log2(x)));
+}
+
+//! @brief Largest power of two not above a positive value.
+inline real_t pow2_floor(real_t x) {
+    return std::exp2(std::floor(std::log2(x)));
+}
+
+/**
+ * @brief Replica count and interval covering a given propagation time, within a given error budget.
+ *
+ * Both the time window covered and the interval are rounded to powers of two, so that devices
+ * with slightly different estimates still agree on replica keys. The interval, which bounds the
+ * time a replica lags behind the current state, is the largest within the tolerance, unless
+ * more than `max_replicas` replicas would be needed.
+ */
+inline std::pair<size_t, times_t> replica_policy(real_t window, real_t tolerance) {
+    real_t w = pow2_ceil(std::max(window, real_t(1e-3)));
+    real_t t = std::min(w, pow2_floor(tolerance));
+    t = std::max(t, pow2_ceil(w / (max_replicas - 1)));
+    return {size_t(w / t + 0.5) + 1, t};
+}
+
+//! @brief A replica policy proposed by some device: interval, replica count and expiry time (in shared clock time).
+using replica_lease = tuple<times_t, size_t, times_t>;
+
+/**
+ * @brief Agrees network-wide on a replica policy, given the one proposed by the device.
+ *
+ * Proposals are gossiped until they expire, and the one with the largest interval wins, so
+ * that neighbours share replica keys. Devices renew their proposal every round for `lease`
+ * units of time, so that the agreed interval decreases once no device proposes it anymore.
+ */
+FUN std::pair<size_t, times_t> replica_agreement(ARGS, std::pair<size_t, times_t> p, times_t clock, times_t lease, size_t* bytes = nullptr) { CODE
+    replica_lease mine{p.second, p.first, clock + lease};
+    if (bytes) {
+        size_stream s;
+        s << mine;
+        *bytes = s.size();
+    }
+    replica_lease agreed = nbr(CALL, mine, [&](field<replica_lease> x){
+        return fold_hood(CALL, [&](replica_lease const& a, replica_lease const& b){
+            if (get<2>(a) < clock) return b;
+            if (get<2>(b) < clock) return a;
+            return a < b ? b : a;
+        }, x, mine);
+    });
+    return {get<1>(agreed), get<0>(agreed)};
+}
+//! @brief Export list for replica_agreement.
+FUN_EXPORT replica_agreement_t = export_list<replica_lease>;
+
+/**
+ * Generic algorithm replicator, adapting the number of replicas and their interval
+ * to the propagation time observed in the network.
+ *
+ * The policy is agreed network-wide (see `replica_agreement`) with proposals lasting twice
+ * the propagation time, so that they reach every device before expiring.
+ *
+ * @param fun       The aggregate code to replicate (without arguments).
+ * @param diameter  The diameter of the network (in hops).
+ * @param tolerance The maximum time a replica should lag behind the current state (error budget).
+ * @param running   If given, set to the number of replicas running in the device.
+ * @param bytes     If given, set to the size of the values exported (see `replicate`).
+ */
+GEN(F) auto adaptive_replicate(ARGS, F fun, real_t diameter, real_t tolerance, size_t* running = nullptr, size_t* bytes = nullptr) { CODE
+    size_t b_time = 0, b_agree = 0, b_repl = 0;
+    times_t clock = shared_clock(CALL);
+    real_t window = propagation_time(CALL, diameter, bytes ? &b_time : nullptr);
+    auto p = replica_agreement(CALL, replica_policy(window, tolerance), clock, 2 * window, bytes ? &b_agree : nullptr);
+    auto r = replicate(CALL, fun, p.first, p.second, running, bytes ? &b_repl : nullptr);
+    if (bytes) {
+        size_stream s;
+        s << clock;
+        *bytes = s.size() + b_time + b_agree + b_repl;
+    }
+    return r;
+}
+//! @brief Export list for adaptive_replicate.
+FUN_EXPORT adaptive_replicate_t = export_list<replicate_t, propagation_time_t, replica_agreement_t, shared_clock_t>;
+
+//! @brief Finally/somewhere operator, implemented by replicating adaptively.
+FUN bool adaptive_somewhere(ARGS, bool f, real_t diameter, real_t tolerance, size_t* running = nullptr, size_t* bytes = nullptr) { CODE
+    return adaptive_replicate(CALL, [&](){
+        return logic::EP(CALL, f);
+    }, diameter, tolerance, running, bytes);
+}
+//! @brief Export list for adaptive_somewhere.
+FUN_EXPORT adaptive_somewhere_t = export_list<adaptive_replicate_t, past_ctl_t>;
+
+
+//! @brief Truth values of N formulas, packed in 64-bit words.
+template <size_t N>
+using formula_bits = std::array<uint64_t, (N + 63) / 64>;
+
+//! @brief Packs the truth values of N formulas.
+template <size_t N>
+formula_bits<N> pack_formulas(std::array<bool, N> const& f) {
+    formula_bits<N> b{};
+    for (size_t k = 0; k < N; ++k) b[k / 64] |= uint64_t(f[k]) << (k % 64);
+    return b;
+}
+
+//! @brief Unpacks the truth values of N formulas.
+template <size_t N>
+std::array<bool, N> unpack_formulas(formula_bits<N> const& b) {
+    std::array<bool, N> f;
+    for (size_t k = 0; k < N; ++k) f[k] = (b[k / 64] >> (k % 64)) & 1;
+    return f;
+}
+
+//! @brief Exists-past operator on N formulas at once, sharing a single exchange of packed truth values.
+template <typename node_t, size_t N>
+formula_bits<N> EP_all(ARGS, formula_bits<N> const& f) { CODE
+    auto disjunction = [](formula_bits<N> a, formula_bits<N> const& b){
+        for (size_t i = 0; i < a.size(); ++i) a[i] |= b[i];
+        return a;
+    };
+    return nbr(CALL, formula_bits<N>{}, [&](field<formula_bits<N>> x){
+        // f holds now, or in a past event of the device or its neighbours
+        return disjunction(fold_hood(CALL, disjunction, x), f);
+    });
+}
+//! @brief Export list for EP_all.
+template <size_t N>
+using EP_all_t = export_list<formula_bits<N>>;
+
+
+/**
+ * @brief Finally/somewhere operator on N formulas, implemented by replicating.
+ *
+ * All formulas are evaluated within the same replicas, so that the replica bookkeeping
+ * and shared clock are computed once, and their truth values are exchanged packed in bits.
+ */
+template <typename node_t, size_t N>
+std::array<bool, N> somewhere(ARGS, std::array<bool, N> const& f, size_t replicas, real_t diameter, real_t infospeed) { CODE
+    formula_bits<N> b = pack_formulas(f);
+    return unpack_formulas<N>(replicate(CALL, [&](){
+        return EP_all(CALL, b);
+    }, replicas, diameter / infospeed / (replicas-1)));
+}
+//! @brief Export list for somewhere on N formulas.
+template <size_t N>
+using somewhere_all_t = export_list<replicate_t, EP_all_t<N>>;
+
+
+/**
+ * @brief Case study checking whether a critic event is happening.
+ *
+ * The replicated operator is computed both with a fixed number of replicas spaced
+ * according to the given information speed, and adaptively within the given tolerance.
+ */
+FUN void criticality_control(ARGS, real_t diameter, real_t infospeed, real_t tolerance) {
     using namespace tags;
     bool oracle = node.current_time() > 10 and node.current_time() < 30;
     bool c = node.uid == 42 and oracle;
+    size_t fixed_bytes, adaptive_bytes;
     node.storage(critic{}) = c;
-    node.storage(ever_critic{}) = logic::EP(CALL, c);
+    node.storage(ever_critic{}) = formula::eval(CALL, formula::EP(c));
     node.storage(now_critic_SLCS{}) = logic::F(CALL, c);
-    node.storage(now_critic_replicated{}) = somewhere(CALL, c, 4, diameter, infospeed);
+    node.storage(now_critic_replicated{}) = somewhere(CALL, c, 4, diameter, infospeed, nullptr, &fixed_bytes);
+    node.storage(now_critic_adaptive{}) = adaptive_somewhere(CALL, c, diameter, tolerance, nullptr, &adaptive_bytes);
     node.storage(error_SLCS{}) = node.storage(now_critic_SLCS{}) != oracle;
     node.storage(error_replicated{}) = node.storage(now_critic_replicated{}) != oracle;
+    node.storage(error_adaptive{}) = node.storage(now_critic_adaptive{}) != oracle;
+    node.storage(size_replicated{}) = fixed_bytes;
+    node.storage(size_adaptive{}) = adaptive_bytes;
 }
 //! @brief Export list for criticality_control.
-FUN_EXPORT criticality_control_t = export_list<somewhere_t, slcs_t>;
+FUN_EXPORT criticality_control_t = export_list<somewhere_t, adaptive_somewhere_t, slcs_t, formula::eval_t<decltype(formula::EP(false))>>;
 
 }
 
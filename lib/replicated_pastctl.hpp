@@ -22,6 +22,8 @@ constexpr size_t dim = 2;
 constexpr size_t communication_range = 100;
 //! @brief End of simulated time.
 constexpr size_t end = 100;
+//! @brief Maximum time adaptive replicas should lag behind the current state.
+constexpr real_t tolerance = 1;
 
 //! @brief Namespace containing the libraries of coordination routines.
 namespace coordination {
@@ -60,7 +62,7 @@ MAIN() {
     // call to the library function handling random movement
     rectangle_walk(CALL, make_vec(0,0), make_vec(node.storage(side{}), node.storage(side{})), node.storage(speed{})*communication_range, 1);
     // call to the case study function
-    criticality_control(CALL, node.storage(hops{}), node.storage(infospeed{}));
+    criticality_control(CALL, node.storage(hops{}), node.storage(infospeed{}), tolerance);
 
     // display formula values in the user interface
     node.storage(node_size{}) = node.storage(critic{}) ? 20 : 10;
@@ -112,8 +114,12 @@ using store_t = tuple_store<
     ever_critic,                bool,
 	now_critic_SLCS,            bool,
     now_critic_replicated,      bool,
+    now_critic_adaptive,        bool,
     error_SLCS,                 bool,
     error_replicated,           bool,
+    error_adaptive,             bool,
+    size_replicated,            size_t,
+    size_adaptive,              size_t,
     seed,                       uint_fast32_t,
     speed,                      double,
     devices,                    size_t,
@@ -127,8 +133,12 @@ using aggregator_t = aggregators<
     ever_critic,            aggregator::mean<double>,
     now_critic_SLCS,        aggregator::mean<double>,
     now_critic_replicated,  aggregator::mean<double>,
+    now_critic_adaptive,    aggregator::mean<double>,
     error_SLCS,             aggregator::mean<double>,
-    error_replicated,       aggregator::mean<double>
+    error_replicated,       aggregator::mean<double>,
+    error_adaptive,         aggregator::mean<double>,
+    size_replicated,        aggregator::mean<double>,
+    size_adaptive,          aggregator::mean<double>
 >;
 
 //! @brief Struct holding default values for simulation parameters.
@@ -182,9 +192,12 @@ struct multi_filter<P,T,Ts...> {
 template <typename P, typename... Ts>
 using multi_filter_t = typename multi_filter<plot::split<common::type_sequence<Ts...>, P>, Ts...>::type;
 
-//! @brief Single generic plot description.
+//! @brief Single generic plot description (errors and message sizes).
 template <typename S>
-using single_plot_t = plot::split<S, plot::values<aggregator_t, common::type_sequence<>, error_SLCS, error_replicated>>;
+using single_plot_t = plot::split<S, plot::join<
+    plot::values<aggregator_t, common::type_sequence<>, error_SLCS, error_replicated, error_adaptive>,
+    plot::values<aggregator_t, common::type_sequence<>, size_replicated, size_adaptive>
+>>;
 
 //! @brief Overall plot document (one plot for every variable).
 using plotter_t = plot::join<
@@ -192,11 +205,32 @@ using plotter_t = plot::join<
     multi_filter_t<single_plot_t<dens>, speed, tvar, hops>,
     multi_filter_t<single_plot_t<hops>, speed, tvar, dens>,
     multi_filter_t<single_plot_t<speed>, tvar, dens, hops>,
-    multi_filter_t<plot::split<plot::time, plot::values<aggregator_t, common::type_sequence<>, critic, ever_critic, now_critic_SLCS, now_critic_replicated>>, tvar, dens, hops, speed>
+    multi_filter_t<plot::split<plot::time, plot::values<aggregator_t, common::type_sequence<>, critic, ever_critic, now_critic_SLCS, now_critic_replicated, now_critic_adaptive>>, tvar, dens, hops, speed>
 >;
 
-//! @brief The general simulation options.
-DECLARE_OPTIONS(list,
+//! @brief The rows read by the plot document (general parameters, aggregated values and time).
+using row_t = common::tagged_tuple_t<
+    seed,                                   uint_fast32_t,
+    tvar,                                   double,
+    dens,                                   double,
+    hops,                                   double,
+    speed,                                  double,
+    plot::time,                             times_t,
+    aggregator::mean<critic>,               double,
+    aggregator::mean<ever_critic>,          double,
+    aggregator::mean<now_critic_SLCS>,      double,
+    aggregator::mean<now_critic_replicated>,double,
+    aggregator::mean<now_critic_adaptive>,  double,
+    aggregator::mean<error_SLCS>,           double,
+    aggregator::mean<error_replicated>,     double,
+    aggregator::mean<error_adaptive>,       double,
+    aggregator::mean<size_replicated>,      double,
+    aggregator::mean<size_adaptive>,        double
+>;
+
+//! @brief The general simulation options, logging to a plotter of type P.
+template <typename P>
+DECLARE_OPTIONS(options_t,
     parallel<true>,      // multithreading enabled on node rounds
     synchronised<false>, // optimise for asynchronous networks
     program<coordination::main>,   // program to be run (refers to MAIN above)
@@ -218,18 +252,22 @@ DECLARE_OPTIONS(list,
     >,
     // general parameters to use for plotting
     extra_info<
+        seed,   uint_fast32_t,
         tvar,   double,
         dens,   double,
         hops,   double,
         speed,  double
     >,
-    plot_type<plotter_t>, // the plot description
+    plot_type<P>, // the plot description
     connector<connect::fixed<communication_range>>, // connection allowed within a fixed comm range
     shape_tag<node_shape>, // the shape of a node is read from this tag in the store
     size_tag<node_size>,   // the size  of a node is read from this tag in the store
     color_tag<node_color>  // the color of a node is read from this tag in the store
 );
 
+//! @brief The general simulation options, logging directly to the plot document.
+using list = options_t<plotter_t>;
+
 } // namespace option
 
 } // namespace fcpp
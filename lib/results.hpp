@@ -0,0 +1,351 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file results.hpp
+ * @brief Buffering, checkpointing and streaming of plot rows, so that simulations can run concurrently or across processes with deterministic plots.
+ */
+
+#ifndef FCPP_RESULTS_H_
+#define FCPP_RESULTS_H_
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "lib/common/tagged_tuple.hpp"
+#include "lib/common/traits.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+
+/**
+ * @brief Plotter recording the rows of a single simulation, to be replayed later into a plotter of type `P`.
+ *
+ * Every simulation logs into its own buffer, so that no plotter is shared between threads.
+ * Replaying the buffers in a fixed order feeds `P` with exactly the same row sequence of a
+ * sequential run, so that the resulting plots are identical regardless of thread scheduling.
+ */
+template <typename P>
+class row_buffer {
+  public:
+    //! @brief Records a row.
+    template <typename R>
+    row_buffer& operator<<(R const& row) {
+        m_rows.emplace_back([row](P& p){
+            p << row;
+        });
+        return *this;
+    }
+
+    //! @brief Feeds the recorded rows into a plotter, in recording order.
+    void replay(P& p) const {
+        for (auto const& r : m_rows) r(p);
+    }
+
+    //! @brief Number of rows recorded.
+    size_t size() const {
+        return m_rows.size();
+    }
+
+    //! @brief Discards the recorded rows.
+    void clear() {
+        m_rows.clear();
+    }
+
+  private:
+    //! @brief The recorded rows, as deferred insertions into a plotter.
+    std::vector<std::function<void(P&)>> m_rows;
+};
+
+
+//! @brief Replays a sequence of row buffers into a plotter, in sequence order.
+template <typename P>
+void replay(std::vector<row_buffer<P>> const& v, P& p) {
+    for (auto const& b : v) b.replay(p);
+}
+
+
+//! @brief Namespace for implementation details.
+namespace details {
+    //! @brief Concatenates row types (empty overload).
+    template <typename... Ts>
+    struct row_cat;
+
+    //! @brief Concatenates row types (single row overload).
+    template <typename T>
+    struct row_cat<T> {
+        using type = T;
+    };
+
+    //! @brief Concatenates row types (active overload).
+    template <typename... S1, typename... U1, typename... S2, typename... U2, typename... Ts>
+    struct row_cat<common::tagged_tuple<common::type_sequence<S1...>, common::type_sequence<U1...>>, common::tagged_tuple<common::type_sequence<S2...>, common::type_sequence<U2...>>, Ts...> : row_cat<common::tagged_tuple<common::type_sequence<S1..., S2...>, common::type_sequence<U1..., U2...>>, Ts...> {};
+
+    //! @brief Writes the tag names of a row type as a comment line.
+    template <typename... Ss, typename... Us>
+    void row_header(std::ostream& o, common::tagged_tuple<common::type_sequence<Ss...>, common::type_sequence<Us...>> const&) {
+        size_t i = 0;
+        int v[] = {0, (o << (i++ ? "," : "# ") << common::type_name<Ss>(), 0)...};
+        (void)v;
+        o << "\n";
+    }
+
+    //! @brief Copies the tags of a row type from a (possibly larger) row.
+    template <typename... Ss, typename... Us, typename T>
+    void row_assign(common::tagged_tuple<common::type_sequence<Ss...>, common::type_sequence<Us...>>& r, T const& row) {
+        int v[] = {0, (common::get<Ss>(r) = common::get<Ss>(row), 0)...};
+        (void)v;
+    }
+
+    //! @brief Writes a value of a row (general overload).
+    template <typename T>
+    std::enable_if_t<not std::is_floating_point<T>::value> value_write(std::ostream& o, T const& x) {
+        o << x;
+    }
+
+    //! @brief Writes a value of a row (floating-point overload, writing non-finite values as `nan`, `inf` or `-inf`).
+    template <typename T>
+    std::enable_if_t<std::is_floating_point<T>::value> value_write(std::ostream& o, T const& x) {
+        if (std::isfinite(x)) o << x;
+        else o << (std::isnan(x) ? "nan" : x > 0 ? "inf" : "-inf");
+    }
+
+    //! @brief Reads a value of a row (general overload).
+    template <typename T>
+    std::enable_if_t<not std::is_floating_point<T>::value> value_read(std::istream& i, T& x) {
+        i >> x;
+    }
+
+    //! @brief Reads a value of a row (floating-point overload, accepting the tokens of non-finite values).
+    template <typename T>
+    std::enable_if_t<std::is_floating_point<T>::value> value_read(std::istream& i, T& x) {
+        std::string s;
+        for (int c = i.peek(); c != ',' and c != std::istream::traits_type::eof(); c = i.peek()) s.push_back(i.get());
+        char* end = nullptr;
+        x = std::strtod(s.c_str(), &end);
+        if (s.empty() or end != s.c_str() + s.size()) i.setstate(std::ios::failbit);
+    }
+
+    //! @brief Writes the values of a row as comma-separated text, with full precision.
+    template <typename... Ss, typename... Us>
+    void row_write(std::ostream& o, common::tagged_tuple<common::type_sequence<Ss...>, common::type_sequence<Us...>> const& r) {
+        o.precision(std::numeric_limits<double>::max_digits10);
+        size_t i = 0;
+        int v[] = {0, (o << (i++ ? "," : ""), value_write(o, common::get<Ss>(r)), 0)...};
+        (void)v;
+    }
+
+    //! @brief Reads a value of a row, preceded by a comma if not the first.
+    template <typename T>
+    void field_read(std::istream& i, T& x, bool first) {
+        if (not first and i.get() != ',') i.setstate(std::ios::failbit);
+        if (i) value_read(i, x);
+    }
+
+    //! @brief Reads the values of a row from comma-separated text, failing if any is missing, malformed or in excess.
+    template <typename... Ss, typename... Us>
+    bool row_read(std::istream& i, common::tagged_tuple<common::type_sequence<Ss...>, common::type_sequence<Us...>>& r) {
+        size_t k = 0;
+        int v[] = {0, (field_read(i, common::get<Ss>(r), k++ == 0), 0)...};
+        (void)v;
+        if (i.fail()) return false;
+        return i.peek() == std::istream::traits_type::eof();
+    }
+}
+
+
+/**
+ * @brief Plotter recording the rows of a single simulation as values of type `R`.
+ *
+ * The tagged tuple `R` needs to contain only the tags read by the plot document.
+ */
+template <typename R>
+class row_log {
+  public:
+    //! @brief Records a row.
+    template <typename T>
+    row_log& operator<<(T const& row) {
+        m_rows.emplace_back();
+        details::row_assign(m_rows.back(), row);
+        return *this;
+    }
+
+    //! @brief The recorded rows.
+    std::vector<R> const& rows() const {
+        return m_rows;
+    }
+
+  private:
+    //! @brief The recorded rows.
+    std::vector<R> m_rows;
+};
+
+
+//! @brief Concatenation of row types (tagged tuples).
+template <typename... Ts>
+using row_cat_t = typename details::row_cat<Ts...>::type;
+
+
+/**
+ * @brief Plotter streaming rows of type `R` to a file as comma-separated values, as they are logged.
+ *
+ * The file starts with a comment line listing the tags of `R`. Rows from different threads
+ * are written whole, in the order in which they are logged.
+ */
+template <typename R>
+class row_stream {
+  public:
+    //! @brief Opens a stream, truncating the file.
+    row_stream(std::string path) : m_path(std::move(path)) {
+        reset();
+    }
+
+    //! @brief Writes a row.
+    template <typename T>
+    row_stream& operator<<(T const& row) {
+        R r;
+        details::row_assign(r, row);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        details::row_write(m_out, r);
+        m_out << std::endl;
+        return *this;
+    }
+
+    //! @brief Discards the rows written so far.
+    void reset() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_out.close();
+        m_out.open(m_path);
+        details::row_header(m_out, R{});
+    }
+
+  private:
+    //! @brief The path of the file.
+    std::string m_path;
+
+    //! @brief The output file.
+    std::ofstream m_out;
+
+    //! @brief Serialises writes from different threads.
+    std::mutex m_mutex;
+};
+
+
+/**
+ * @brief Reads the rows of type `R` in a file written by a `row_stream`, calling `f` on each of them.
+ *
+ * @return The number of malformed rows, which are skipped.
+ */
+template <typename R, typename F>
+size_t read_rows(std::istream& in, F&& f) {
+    size_t malformed = 0;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() or line[0] == '#') continue;
+        std::istringstream is(line);
+        R r;
+        if (details::row_read(is, r)) f(r);
+        else ++malformed;
+    }
+    return malformed;
+}
+
+
+/**
+ * @brief Checkpoint file collecting the rows of completed runs, indexed by their position in a sweep.
+ *
+ * Every line holds a run index followed by the values of a row. The rows of a run are
+ * appended at once and followed by a `#done` line (also for runs logging no rows), so that
+ * runs interrupted while writing are discarded on reload and executed again. Files holding
+ * such runs are rewritten into a temporary file first, which then replaces the original,
+ * so that no completed run is lost if the rewrite is interrupted as well.
+ */
+template <typename R>
+class checkpoint_file {
+  public:
+    //! @brief Opens a checkpoint file, loading the runs completed so far.
+    checkpoint_file(std::string path) : m_path(std::move(path)) {
+        std::ifstream in(m_path);
+        std::map<size_t, std::vector<R>> pending;
+        bool clean = true;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream is(line);
+            size_t idx;
+            if (line.compare(0, 5, "#done") == 0) {
+                is.ignore(5);
+                if (is >> idx) {
+                    m_runs[idx] = std::move(pending[idx]);
+                    pending.erase(idx);
+                }
+                continue;
+            }
+            char c;
+            R r;
+            if (is >> idx && is.get(c) && details::row_read(is, r)) pending[idx].push_back(r);
+            else clean = false;
+        }
+        in.close();
+        if (clean and pending.empty()) return;
+        // rewrites the file without incomplete runs, replacing it only once fully written
+        std::string tmp = m_path + ".tmp";
+        {
+            std::ofstream out(tmp);
+            for (auto const& x : m_runs) write(out, x.first, x.second);
+        }
+        std::rename(tmp.c_str(), m_path.c_str());
+    }
+
+    //! @brief Whether the run with a given index has been completed.
+    bool done(size_t i) const {
+        return m_runs.count(i);
+    }
+
+    //! @brief Saves the rows of a completed run.
+    void save(size_t i, std::vector<R> const& rows) {
+        std::ofstream out(m_path, std::ios::app);
+        write(out, i, rows);
+        m_runs[i] = rows;
+    }
+
+    //! @brief The completed runs, by index.
+    std::map<size_t, std::vector<R>> const& runs() const {
+        return m_runs;
+    }
+
+  private:
+    //! @brief Writes and flushes the rows of a run.
+    static void write(std::ostream& o, size_t i, std::vector<R> const& rows) {
+        for (R const& r : rows) {
+            o << i << ",";
+            details::row_write(o, r);
+            o << "\n";
+        }
+        o << "#done " << i << std::endl;
+    }
+
+    //! @brief The path of the file.
+    std::string m_path;
+
+    //! @brief The completed runs, by index.
+    std::map<size_t, std::vector<R>> m_runs;
+};
+
+
+}
+
+#endif // FCPP_RESULTS_H_
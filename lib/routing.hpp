@@ -0,0 +1,518 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file routing.hpp
+ * @brief Routing sets used to dispatch messages along spanning trees.
+ */
+
+#ifndef FCPP_ROUTING_H_
+#define FCPP_ROUTING_H_
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "lib/generals.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+
+/**
+ * @brief Exact set of device UIDs, stored as a sorted contiguous array.
+ *
+ * Up to `inline_size` UIDs are stored within the object, larger sets on the heap.
+ * Membership is tested by binary search, and sets are merged linearly in place.
+ * The heap buffer is kept when the set shrinks or is assigned, so that a set
+ * reassigned every round stops allocating once it reached its largest size.
+ */
+class device_set {
+  public:
+    //! @brief Number of UIDs stored without heap allocations.
+    static constexpr size_t inline_size = 4;
+
+    //! @brief Empty constructor.
+    device_set() : m_size(0), m_inline{} {}
+
+    //! @brief Constructor from a list of UIDs.
+    device_set(std::initializer_list<device_t> l) : m_size(0), m_inline{} {
+        for (device_t d : l) insert(d);
+    }
+
+    //! @brief Copy constructor.
+    device_set(device_set const& o) : m_size(0), m_inline{} {
+        assign(o.begin(), o.size());
+    }
+
+    //! @brief Move constructor.
+    device_set(device_set&& o) noexcept : m_size(o.m_size), m_inline(o.m_inline), m_heap(std::move(o.m_heap)) {
+        o.m_size = 0;
+    }
+
+    //! @brief Copy assignment (reusing the heap buffer).
+    device_set& operator=(device_set const& o) {
+        if (this != &o) assign(o.begin(), o.size());
+        return *this;
+    }
+
+    //! @brief Move assignment (handing the heap buffer over to the other set).
+    device_set& operator=(device_set&& o) noexcept {
+        if (this == &o) return *this;
+        m_size = o.m_size;
+        m_inline = o.m_inline;
+        m_heap.swap(o.m_heap);
+        o.m_size = 0;
+        return *this;
+    }
+
+    //! @brief Number of UIDs in the set.
+    size_t size() const {
+        return m_size;
+    }
+
+    //! @brief Whether the set is empty.
+    bool empty() const {
+        return m_size == 0;
+    }
+
+    //! @brief First UID in the set.
+    device_t const* begin() const {
+        return data();
+    }
+
+    //! @brief One past the last UID in the set.
+    device_t const* end() const {
+        return data() + m_size;
+    }
+
+    //! @brief Removes every UID (keeping the heap buffer).
+    void clear() {
+        m_size = 0;
+    }
+
+    //! @brief Returns 1 if the UID is in the set, 0 otherwise.
+    size_t count(device_t d) const {
+        return std::binary_search(begin(), end(), d);
+    }
+
+    //! @brief Inserts a UID in the set.
+    void insert(device_t d) {
+        size_t i = std::lower_bound(begin(), end(), d) - begin();
+        if (i < m_size and data()[i] == d) return;
+        if (m_size < inline_size) {
+            std::copy_backward(m_inline.begin() + i, m_inline.begin() + m_size, m_inline.begin() + m_size + 1);
+            m_inline[i] = d;
+        } else {
+            if (m_size == inline_size) m_heap.assign(m_inline.begin(), m_inline.end());
+            m_heap.insert(m_heap.begin() + i, d);
+        }
+        ++m_size;
+    }
+
+    //! @brief Inserts every UID of another set (linear merge, in place).
+    void insert(device_set const& o) {
+        device_t const* x = begin();
+        device_t const* y = o.begin();
+        // size of the union
+        size_t n = m_size;
+        for (size_t i = 0, j = 0; j < o.m_size; ++j) {
+            while (i < m_size and x[i] < y[j]) ++i;
+            if (i < m_size and x[i] == y[j]) ++i;
+            else ++n;
+        }
+        if (n == m_size) return;
+        if (n > inline_size) {
+            if (m_size <= inline_size) {
+                m_heap.resize(n);
+                std::copy(m_inline.begin(), m_inline.begin() + m_size, m_heap.begin());
+            } else m_heap.resize(n);
+        }
+        device_t* z = n > inline_size ? m_heap.data() : m_inline.data();
+        // merges from the back, so that every UID is moved at most once
+        size_t i = m_size, j = o.m_size, k = n;
+        while (j > 0) {
+            if (i > 0 and z[i-1] >= y[j-1]) {
+                if (z[i-1] == y[j-1]) --j;
+                z[--k] = z[--i];
+            } else z[--k] = y[--j];
+        }
+        m_size = n;
+    }
+
+    //! @brief Removes a UID from the set.
+    void erase(device_t d) {
+        size_t i = std::lower_bound(begin(), end(), d) - begin();
+        if (i == m_size or data()[i] != d) return;
+        if (m_size <= inline_size) {
+            std::copy(m_inline.begin() + i + 1, m_inline.begin() + m_size, m_inline.begin() + i);
+        } else {
+            m_heap.erase(m_heap.begin() + i);
+            if (m_size == inline_size + 1) std::copy(m_heap.begin(), m_heap.end(), m_inline.begin());
+        }
+        --m_size;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(device_set const& o) const {
+        return m_size == o.m_size and std::equal(begin(), end(), o.begin());
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(device_set const& o) const {
+        return not (*this == o);
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        size_t n = m_size;
+        s & n;
+        if (n > inline_size) m_heap.resize(n);
+        m_size = n;
+        for (device_t* p = data(); p != data() + n; ++p) s & *p;
+        return s;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        s << m_size;
+        for (device_t d : *this) s << d;
+        return s;
+    }
+
+  private:
+    //! @brief Sets the content to a sorted array of UIDs.
+    void assign(device_t const* p, size_t n) {
+        if (n > inline_size) m_heap.assign(p, p + n);
+        else std::copy(p, p + n, m_inline.begin());
+        m_size = n;
+    }
+
+    //! @brief Pointer to the UIDs in the set.
+    device_t* data() {
+        return m_size > inline_size ? m_heap.data() : m_inline.data();
+    }
+
+    //! @brief Pointer to the UIDs in the set (const overload).
+    device_t const* data() const {
+        return m_size > inline_size ? m_heap.data() : m_inline.data();
+    }
+
+    //! @brief Number of UIDs in the set.
+    size_t m_size;
+
+    //! @brief UIDs of small sets.
+    std::array<device_t, inline_size> m_inline;
+
+    //! @brief UIDs of large sets (holding exactly the set when larger than `inline_size`).
+    std::vector<device_t> m_heap;
+};
+
+
+/**
+ * @brief Fixed-size Bloom filter of device UIDs.
+ *
+ * Membership tests may give false positives, but never false negatives.
+ * Positions are computed through double hashing of a 64-bit mix of the UID.
+ *
+ * @param bits   The number of bits in the filter.
+ * @param hashes The number of hash functions.
+ */
+template <size_t bits, size_t hashes>
+class bloom_filter {
+    static_assert(bits > 0 and hashes > 0, "a Bloom filter needs at least one bit and one hash function");
+
+    //! @brief Number of 64-bit words holding the filter.
+    static constexpr size_t words = (bits + 63) / 64;
+
+  public:
+    //! @brief Empty constructor.
+    bloom_filter() : m_data{} {}
+
+    //! @brief Constructor from a list of UIDs.
+    bloom_filter(std::initializer_list<device_t> l) : m_data{} {
+        for (device_t d : l) insert(d);
+    }
+
+    //! @brief Inserts a UID in the filter.
+    void insert(device_t d) {
+        uint64_t h = mix(d);
+        for (size_t i = 0; i < hashes; ++i) {
+            size_t p = position(h, i);
+            m_data[p / 64] |= uint64_t(1) << (p % 64);
+        }
+    }
+
+    //! @brief Inserts every UID of another filter (bitwise union).
+    void insert(bloom_filter const& o) {
+        for (size_t i = 0; i < words; ++i) m_data[i] |= o.m_data[i];
+    }
+
+    //! @brief Returns 1 if the UID may be in the filter, 0 if it surely is not.
+    size_t count(device_t d) const {
+        uint64_t h = mix(d);
+        for (size_t i = 0; i < hashes; ++i) {
+            size_t p = position(h, i);
+            if (((m_data[p / 64] >> (p % 64)) & 1) == 0) return 0;
+        }
+        return 1;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(bloom_filter const& o) const {
+        return m_data == o.m_data;
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(bloom_filter const& o) const {
+        return m_data != o.m_data;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & m_data;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << m_data;
+    }
+
+  private:
+    //! @brief Finaliser of SplitMix64, spreading UID bits over the whole word.
+    static uint64_t mix(uint64_t x) {
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    //! @brief The i-th bit position for a mixed UID (double hashing).
+    static size_t position(uint64_t h, size_t i) {
+        uint64_t h1 = h & 0xffffffffULL;
+        uint64_t h2 = (h >> 32) | 1;
+        return (h1 + i * h2) % bits;
+    }
+
+    //! @brief The filter bits.
+    std::array<uint64_t, words> m_data;
+};
+
+
+/**
+ * @brief Interval of DFS labels of the devices in a subtree.
+ *
+ * Membership is tested on labels rather than UIDs: the label of a device is the lower
+ * end of its own interval (see `route_address`).
+ */
+struct interval_label {
+    //! @brief Lowest label in the subtree (label of the subtree root).
+    device_t lo;
+    //! @brief One past the highest label in the subtree.
+    device_t hi;
+
+    //! @brief Empty constructor.
+    interval_label() : lo(0), hi(0) {}
+
+    //! @brief Member constructor.
+    interval_label(device_t lo, device_t hi) : lo(lo), hi(hi) {}
+
+    //! @brief Returns 1 if the label is in the interval, 0 otherwise.
+    size_t count(device_t label) const {
+        return lo <= label and label < hi;
+    }
+
+    //! @brief Equality operator.
+    bool operator==(interval_label const& o) const {
+        return lo == o.lo and hi == o.hi;
+    }
+
+    //! @brief Inequality operator.
+    bool operator!=(interval_label const& o) const {
+        return not (*this == o);
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & lo & hi;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << lo << hi;
+    }
+};
+
+
+//! @brief Merges a routing set into another (hash set overload).
+template <typename T, typename... Ts>
+void merge_routes(std::unordered_set<T, Ts...>& x, std::unordered_set<T, Ts...> const& y) {
+    x.insert(y.begin(), y.end());
+}
+
+//! @brief Merges a routing set into another (sorted set overload).
+inline void merge_routes(device_set& x, device_set const& y) {
+    x.insert(y);
+}
+
+//! @brief Merges a routing set into another (Bloom filter overload).
+template <size_t bits, size_t hashes>
+void merge_routes(bloom_filter<bits, hashes>& x, bloom_filter<bits, hashes> const& y) {
+    x.insert(y);
+}
+
+
+//! @brief Address of a device in routing sets, given a routing set of the same type (UID overload).
+template <typename node_t, typename S>
+device_t route_address(node_t&, S const&, device_t uid) {
+    return uid;
+}
+
+/**
+ * @brief Address of a device in routing sets, given a routing set of the same type (interval overload).
+ *
+ * The current DFS label of the device is read from its storage, standing in for a name service.
+ */
+template <typename node_t>
+device_t route_address(node_t& node, interval_label const&, device_t uid) {
+    return node.net.node_at(uid).storage(tags::dfs_label{});
+}
+
+
+//! @brief Position of a device in a spanning forest, whose roots are the devices with UID lower than their number.
+struct forest_info {
+    //! @brief Root of the tree of the device.
+    device_t root;
+    //! @brief Next hop towards every root (empty for a single tree).
+    std::vector<device_t> hops;
+};
+
+/**
+ * @brief Next hop towards the tree of a destination, or the device itself if already in it.
+ *
+ * The current root of the destination is read from its storage, standing in for a name service.
+ */
+template <typename node_t>
+device_t forest_hop(node_t& node, forest_info const& f, device_t to) {
+    if (f.hops.empty()) return node.uid;
+    device_t r = node.net.node_at(to).storage(tags::tree_root{});
+    return r == f.root or r >= f.hops.size() ? node.uid : f.hops[r];
+}
+
+//! @brief Root of the tree of the device along given parents (the device itself if it is its own parent).
+FUN device_t forest_root(ARGS, device_t parent) { CODE
+    return nbr(CALL, node.uid, [&](field<device_t> r){
+        return parent == node.uid ? node.uid : fcpp::details::self(r, parent);
+    });
+}
+//! @brief Export list for forest_root.
+FUN_EXPORT forest_root_t = export_list<device_t>;
+
+/**
+ * @brief Next hops along shortest paths towards every root of a spanning forest.
+ *
+ * Distances from all roots are computed by a single exchange of an array with one entry per root.
+ *
+ * @param roots The number of roots (the devices with UID lower than it).
+ * @param bytes If given, set to the serialised size of the data exported by the device.
+ */
+FUN std::vector<device_t> root_table(ARGS, size_t roots, size_t* bytes = nullptr) { CODE
+    std::vector<device_t> hops(roots, node.uid);
+    field<real_t> const& nd = node.nbr_dist();
+    nbr(CALL, std::vector<real_t>(roots, INF), [&](field<std::vector<real_t>> d){
+        std::vector<real_t> r(roots, INF);
+        for (device_t j : fcpp::details::get_ids(node.nbr_uid())) if (j != node.uid) {
+            std::vector<real_t> const& dj = fcpp::details::self(d, j);
+            real_t w = fcpp::details::self(nd, j);
+            for (size_t k = 0; k < roots and k < dj.size(); ++k) if (dj[k] + w < r[k]) {
+                r[k] = dj[k] + w;
+                hops[k] = j;
+            }
+        }
+        if (node.uid < roots) {
+            r[node.uid] = 0;
+            hops[node.uid] = node.uid;
+        }
+        if (bytes) {
+            size_stream s;
+            s << r;
+            *bytes = s.size();
+        }
+        return r;
+    });
+    return hops;
+}
+//! @brief Export list for root_table.
+FUN_EXPORT root_table_t = export_list<std::vector<real_t>>;
+
+
+/**
+ * @brief Computes DFS interval labels along a tree with given parents.
+ *
+ * Subtree sizes are collected towards the root, which takes the interval [0, size).
+ * Every node then splits its interval among its children in UID order, sending each
+ * child its own offset (in a field holding the children only, so that a node exchanges its
+ * subtree size and one offset per child). Labels are recomputed every round, so that a
+ * re-parenting only affects the sizes along the old and new paths to the root and the
+ * offsets below them. Every root takes the interval starting at 0, so that labels are
+ * unique only within a single tree.
+ */
+FUN interval_label interval_labelling(ARGS, device_t parent) { CODE
+    field<bool> child = nbr(CALL, parent) == node.uid;
+    // subtree sizes collected along the tree, as in parent_collection, keeping those of neighbours
+    field<size_t> nsize;
+    size_t size = nbr(CALL, size_t(0), [&](field<size_t> x){
+        nsize = x;
+        return fold_hood(CALL, [](size_t x, size_t y){
+            return x + y;
+        }, mux(child, x, size_t(0)), size_t(1));
+    });
+    interval_label label;
+    nbr(CALL, field<device_t>(0), [&](field<device_t> offs){
+        device_t lo = parent == node.uid ? 0 : fcpp::details::self(offs, parent);
+        label = {lo, device_t(lo + size)};
+        // children with their subtree sizes, sorted by UID
+        std::vector<std::pair<device_t, size_t>> children;
+        map_hood([&](device_t d, bool c, size_t s){
+            if (c and d != node.uid) children.emplace_back(d, s);
+            return c;
+        }, node.nbr_uid(), child, nsize);
+        std::sort(children.begin(), children.end());
+        // offsets of the children intervals (0 for other neighbours)
+        std::vector<device_t> ids;
+        std::vector<device_t> offsets{0};
+        device_t next = lo + 1;
+        for (auto const& c : children) {
+            ids.push_back(c.first);
+            offsets.push_back(next);
+            next += c.second;
+        }
+        return fcpp::details::make_field(std::move(ids), std::move(offsets));
+    });
+    return label;
+}
+//! @brief Export list for interval_labelling.
+FUN_EXPORT interval_labelling_t = export_list<size_t, device_t, field<device_t>>;
+
+
+} // coordination
+
+
+} // fcpp
+
+#endif // FCPP_ROUTING_H_
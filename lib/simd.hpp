@@ -0,0 +1,233 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file simd.hpp
+ * @brief Vectorised reductions over the values of neighbour fields.
+ *
+ * Kernels run on contiguous arrays of values, with AVX or SSE2 instructions when the target
+ * supports them and a scalar loop otherwise. Hood wrappers apply them to the values of fields
+ * aligned to the current domain, falling back to the general hood operators otherwise.
+ */
+
+#ifndef FCPP_SIMD_H_
+#define FCPP_SIMD_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "lib/coordination.hpp"
+#include "lib/data.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing vectorised kernels.
+namespace simd {
+
+
+//! @brief Vector instructions on a given value type (scalar fallback).
+template <typename T>
+struct lanes {
+    using type = T;
+    static constexpr size_t width = 1;
+    static type load(T const* p) { return *p; }
+    static void store(T* p, type x) { *p = x; }
+    static type set1(T x) { return x; }
+    static type min(type x, type y) { return x < y ? x : y; }
+    static type max(type x, type y) { return x > y ? x : y; }
+    static type add(type x, type y) { return x + y; }
+    static type sub(type x, type y) { return x - y; }
+    static type div(type x, type y) { return x / y; }
+};
+
+#if defined(__AVX__)
+//! @brief Vector instructions on doubles (AVX).
+template <>
+struct lanes<double> {
+    using type = __m256d;
+    static constexpr size_t width = 4;
+    static type load(double const* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, type x) { _mm256_storeu_pd(p, x); }
+    static type set1(double x) { return _mm256_set1_pd(x); }
+    static type min(type x, type y) { return _mm256_min_pd(x, y); }
+    static type max(type x, type y) { return _mm256_max_pd(x, y); }
+    static type add(type x, type y) { return _mm256_add_pd(x, y); }
+    static type sub(type x, type y) { return _mm256_sub_pd(x, y); }
+    static type div(type x, type y) { return _mm256_div_pd(x, y); }
+};
+
+//! @brief Vector instructions on floats (AVX).
+template <>
+struct lanes<float> {
+    using type = __m256;
+    static constexpr size_t width = 8;
+    static type load(float const* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, type x) { _mm256_storeu_ps(p, x); }
+    static type set1(float x) { return _mm256_set1_ps(x); }
+    static type min(type x, type y) { return _mm256_min_ps(x, y); }
+    static type max(type x, type y) { return _mm256_max_ps(x, y); }
+    static type add(type x, type y) { return _mm256_add_ps(x, y); }
+    static type sub(type x, type y) { return _mm256_sub_ps(x, y); }
+    static type div(type x, type y) { return _mm256_div_ps(x, y); }
+};
+#elif defined(__SSE2__)
+//! @brief Vector instructions on doubles (SSE2).
+template <>
+struct lanes<double> {
+    using type = __m128d;
+    static constexpr size_t width = 2;
+    static type load(double const* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, type x) { _mm_storeu_pd(p, x); }
+    static type set1(double x) { return _mm_set1_pd(x); }
+    static type min(type x, type y) { return _mm_min_pd(x, y); }
+    static type max(type x, type y) { return _mm_max_pd(x, y); }
+    static type add(type x, type y) { return _mm_add_pd(x, y); }
+    static type sub(type x, type y) { return _mm_sub_pd(x, y); }
+    static type div(type x, type y) { return _mm_div_pd(x, y); }
+};
+
+//! @brief Vector instructions on floats (SSE2).
+template <>
+struct lanes<float> {
+    using type = __m128;
+    static constexpr size_t width = 4;
+    static type load(float const* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, type x) { _mm_storeu_ps(p, x); }
+    static type set1(float x) { return _mm_set1_ps(x); }
+    static type min(type x, type y) { return _mm_min_ps(x, y); }
+    static type max(type x, type y) { return _mm_max_ps(x, y); }
+    static type add(type x, type y) { return _mm_add_ps(x, y); }
+    static type sub(type x, type y) { return _mm_sub_ps(x, y); }
+    static type div(type x, type y) { return _mm_div_ps(x, y); }
+};
+#endif
+
+
+//! @brief Minimum of x[i] + y[i] over n values (INF if empty, NaN values are ignored).
+template <typename T>
+T min_sum(T const* x, T const* y, size_t n) {
+    using L = lanes<T>;
+    T r = std::numeric_limits<T>::infinity();
+    size_t i = 0;
+    if (n >= L::width) {
+        typename L::type m = L::set1(r);
+        for (; i + L::width <= n; i += L::width)
+            m = L::min(L::add(L::load(x + i), L::load(y + i)), m);
+        T buf[L::width];
+        L::store(buf, m);
+        for (T v : buf) r = std::min(r, v);
+    }
+    for (; i < n; ++i) r = std::min(r, x[i] + y[i]);
+    return r;
+}
+
+//! @brief Writes x[i] + y[i] into z[i] for n values.
+template <typename T>
+void add(T const* x, T const* y, T* z, size_t n) {
+    using L = lanes<T>;
+    size_t i = 0;
+    for (; i + L::width <= n; i += L::width)
+        L::store(z + i, L::add(L::load(x + i), L::load(y + i)));
+    for (; i < n; ++i) z[i] = x[i] + y[i];
+}
+
+//! @brief Writes (c - x[i]) / y[i] into z[i] for n values.
+template <typename T>
+void slope(T c, T const* x, T const* y, T* z, size_t n) {
+    using L = lanes<T>;
+    size_t i = 0;
+    typename L::type vc = L::set1(c);
+    for (; i + L::width <= n; i += L::width)
+        L::store(z + i, L::div(L::sub(vc, L::load(x + i)), L::load(y + i)));
+    for (; i < n; ++i) z[i] = (c - x[i]) / y[i];
+}
+
+//! @brief Minimum of n values (INF if empty, NaN values are ignored).
+template <typename T>
+T min(T const* x, size_t n) {
+    using L = lanes<T>;
+    T r = std::numeric_limits<T>::infinity();
+    size_t i = 0;
+    if (n >= L::width) {
+        typename L::type m = L::set1(r);
+        for (; i + L::width <= n; i += L::width) m = L::min(L::load(x + i), m);
+        T buf[L::width];
+        L::store(buf, m);
+        for (T v : buf) r = std::min(r, v);
+    }
+    for (; i < n; ++i) r = std::min(r, x[i]);
+    return r;
+}
+
+//! @brief Maximum of n values (-INF if empty, NaN values are ignored).
+template <typename T>
+T max(T const* x, size_t n) {
+    using L = lanes<T>;
+    T r = -std::numeric_limits<T>::infinity();
+    size_t i = 0;
+    if (n >= L::width) {
+        typename L::type m = L::set1(r);
+        for (; i + L::width <= n; i += L::width) m = L::max(L::load(x + i), m);
+        T buf[L::width];
+        L::store(buf, m);
+        for (T v : buf) r = std::max(r, v);
+    }
+    for (; i < n; ++i) r = std::max(r, x[i]);
+    return r;
+}
+
+
+//! @brief Whether a field lists exactly the devices in the current domain.
+template <typename node_t, typename T>
+bool aligned(node_t& node, field<T> const& x) {
+    return fcpp::details::get_ids(x) == fcpp::details::get_ids(node.nbr_uid());
+}
+
+//! @brief Whether some fields list exactly the devices in the current domain.
+template <typename node_t, typename T, typename U, typename... Ts>
+bool aligned(node_t& node, field<T> const& x, field<U> const& y, field<Ts> const&... zs) {
+    return aligned(node, x) and aligned(node, y, zs...);
+}
+
+//! @brief Pointer to the values of a field aligned to the current domain, in the order of the domain.
+template <typename T>
+T const* values(field<T> const& x) {
+    return fcpp::details::get_vals(x).data() + 1;
+}
+
+
+} // simd
+
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+//! @brief Minimum over the domain of the sum of two fields (general overload).
+template <typename node_t, typename T, typename U>
+real_t min_sum_hood(ARGS, field<T> const& x, field<U> const& y) {
+    return min_hood(CALL, x + y);
+}
+
+//! @brief Minimum over the domain of the sum of two fields (vectorised overload).
+template <typename node_t>
+real_t min_sum_hood(ARGS, field<real_t> const& x, field<real_t> const& y) {
+    if (simd::aligned(node, x, y))
+        return simd::min_sum(simd::values(x), simd::values(y), fcpp::details::get_ids(x).size());
+    return min_hood(CALL, x + y);
+}
+
+} // coordination
+
+
+} // fcpp
+
+#endif // FCPP_SIMD_H_
@@ -0,0 +1,166 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file traffic.hpp
+ * @brief Parametric generation of messages, with configurable arrivals, endpoints and load.
+ *
+ * The shape of traffic is read from the node storage: the offered `load` (messages per unit
+ * of time over the whole network), the `arrivals` process, the distributions of `senders`
+ * and `receivers`, and the `ramp` of the load across the generation window.
+ */
+
+#ifndef FCPP_TRAFFIC_H_
+#define FCPP_TRAFFIC_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "lib/common/option.hpp"
+
+#include "lib/generals.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+
+//! @brief Arrival processes of messages.
+enum class arrival : uint8_t {
+    once,    //!< A single message per sender, after `once_time`.
+    poisson, //!< Poisson arrivals in every sender.
+    bursty   //!< Poisson arrivals in every sender during on periods, alternating with off periods.
+};
+
+//! @brief Names of the arrival processes.
+constexpr char const* arrival_names[] = {"once", "poisson", "bursty"};
+
+//! @brief Distributions of senders or receivers of messages.
+enum class endpoint : uint8_t {
+    uniform, //!< Every device equally likely.
+    hotspot, //!< A share `hot_share` of messages on `hot_devices` devices, the rest uniform.
+    single   //!< A single device (all-to-one for receivers).
+};
+
+//! @brief Names of the distributions of senders or receivers.
+constexpr char const* endpoint_names[] = {"uniform", "hotspot", "single"};
+
+//! @brief Parses the name of an arrival process or distribution of endpoints, returning its index (or -1 if unknown).
+template <size_t n>
+int traffic_parse(char const* const (&names)[n], char const* s) {
+    for (size_t i = 0; i < n; ++i) if (std::strcmp(names[i], s) == 0) return i;
+    return -1;
+}
+
+
+//! @brief Start of recurring message generation.
+constexpr times_t traffic_start = 1;
+
+//! @brief End of recurring message generation.
+constexpr times_t traffic_stop = 26;
+
+//! @brief Time after which single messages are sent.
+constexpr times_t once_time = 10;
+
+//! @brief Number of hotspot devices (the last ones as senders, the first ones as receivers).
+constexpr size_t hot_devices = 10;
+
+//! @brief Share of messages sent by (or to) hotspot devices.
+constexpr real_t hot_share = 0.8;
+
+//! @brief Average duration of on periods of bursty arrivals.
+constexpr real_t burst_length = 2;
+
+//! @brief Average fraction of time spent in on periods by bursty arrivals.
+constexpr real_t burst_duty = 0.2;
+
+
+//! @brief Share of the messages sent by a device, given the distribution of senders.
+inline real_t sender_share(endpoint e, device_t uid, size_t devices) {
+    switch (e) {
+        case endpoint::uniform:
+            return real_t(1) / devices;
+        case endpoint::hotspot: {
+            size_t hot = std::min(hot_devices, devices);
+            return (1 - hot_share) / devices + (uid + hot >= devices ? hot_share / hot : 0);
+        }
+        case endpoint::single:
+            return uid + 1 == devices ? 1 : 0;
+    }
+    return 0;
+}
+
+//! @brief Load offered by the network at a given time (the load ramps linearly by `ramp` times itself across the window).
+inline real_t traffic_load(real_t load, real_t ramp, times_t t) {
+    real_t x = std::min(std::max((t - traffic_start) / (traffic_stop - traffic_start), times_t(0)), times_t(1));
+    return load * (1 + ramp * x);
+}
+
+//! @brief Picks the receiver of a message, given the distribution of receivers.
+FUN device_t pick_receiver(ARGS, endpoint e, size_t devices) {
+    switch (e) {
+        case endpoint::uniform:
+            return node.next_int(devices-1);
+        case endpoint::hotspot:
+            if (node.next_real() < hot_share) return node.next_int(std::min(hot_devices, devices) - 1);
+            return node.next_int(devices-1);
+        case endpoint::single:
+            return 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Possibly generates a message, given the number of devices.
+ *
+ * Recurring arrivals generate at most one message per round, with the probability of at least
+ * one Poisson arrival since the previous round within the generation window. Bursty arrivals
+ * switch between on and off periods of exponential durations, with rates during on periods
+ * scaled so that the average load is preserved.
+ */
+FUN common::option<message> get_message(ARGS, size_t devices) { CODE
+    using namespace tags;
+    common::option<message> m;
+    arrival a = arrival(node.storage(arrivals{}));
+    real_t share = sender_share(endpoint(node.storage(senders{})), node.uid, devices);
+    times_t now = node.current_time();
+    // elapsed time since the previous round within the generation window
+    times_t dt = std::max(std::min(now, traffic_stop) - std::max(node.previous_time(), traffic_start), times_t(0));
+    real_t rate = share * traffic_load(node.storage(load{}), node.storage(ramp{}), now);
+    bool on = old(CALL, false, [&](bool o){
+        real_t length = o ? burst_length : burst_length * (1 - burst_duty) / burst_duty;
+        return a == arrival::bursty and (node.next_real() < 1 - std::exp(-dt / length) ? not o : o);
+    });
+    bool genmsg = false;
+    switch (a) {
+        case arrival::once:
+            genmsg = share > 0 and now > once_time and node.storage(sent_count{}) == 0;
+            break;
+        case arrival::poisson:
+            genmsg = node.next_real() < 1 - std::exp(-rate * dt);
+            break;
+        case arrival::bursty:
+            genmsg = on and node.next_real() < 1 - std::exp(-rate / burst_duty * dt);
+            break;
+    }
+    if (genmsg) {
+        m.emplace(node.uid, pick_receiver(CALL, endpoint(node.storage(receivers{})), devices), now, node.next_real());
+        node.storage(sent_count{}) += 1;
+    }
+    return m;
+}
+//! @brief Export list for get_message.
+FUN_EXPORT get_message_t = export_list<bool>;
+
+
+} // coordination
+
+} // fcpp
+
+#endif // FCPP_TRAFFIC_H_
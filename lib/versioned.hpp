@@ -0,0 +1,254 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file versioned.hpp
+ * @brief Exchange of heavy values with neighbours through versions and deltas.
+ */
+
+#ifndef FCPP_VERSIONED_H_
+#define FCPP_VERSIONED_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "lib/generals.hpp"
+#include "lib/routing.hpp"
+
+
+/**
+ * @brief Namespace containing all the objects in the FCPP library.
+ */
+namespace fcpp {
+
+//! @brief Namespace containing the libraries of coordination routines.
+namespace coordination {
+
+
+//! @brief Changes of a set of UIDs, as UIDs added and removed.
+struct id_delta {
+    //! @brief UIDs added.
+    std::vector<device_t> added;
+    //! @brief UIDs removed.
+    std::vector<device_t> removed;
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & added & removed;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << added << removed;
+    }
+};
+
+//! @brief Computes the changes from a value to another, returning whether they can be expressed as a delta (generic overload: never).
+template <typename T>
+bool make_delta(T const&, T const&, id_delta&) {
+    return false;
+}
+
+//! @brief Computes the changes from a value to another, returning whether they can be expressed as a delta (hash set overload).
+template <typename... Ts>
+bool make_delta(std::unordered_set<device_t, Ts...> const& from, std::unordered_set<device_t, Ts...> const& to, id_delta& d) {
+    d.added.clear();
+    d.removed.clear();
+    for (device_t x : to) if (not from.count(x)) d.added.push_back(x);
+    for (device_t x : from) if (not to.count(x)) d.removed.push_back(x);
+    // a delta larger than the value is not worth it
+    return d.added.size() + d.removed.size() < to.size();
+}
+
+//! @brief Computes the changes from a value to another, returning whether they can be expressed as a delta (sorted set overload).
+inline bool make_delta(device_set const& from, device_set const& to, id_delta& d) {
+    d.added.clear();
+    d.removed.clear();
+    std::set_difference(to.begin(), to.end(), from.begin(), from.end(), std::back_inserter(d.added));
+    std::set_difference(from.begin(), from.end(), to.begin(), to.end(), std::back_inserter(d.removed));
+    return d.added.size() + d.removed.size() < to.size();
+}
+
+//! @brief Applies changes to a value (generic overload: never called).
+template <typename T>
+void apply_delta(T&, id_delta const&) {}
+
+//! @brief Applies changes to a value (hash set overload).
+template <typename... Ts>
+void apply_delta(std::unordered_set<device_t, Ts...>& x, id_delta const& d) {
+    for (device_t y : d.removed) x.erase(y);
+    for (device_t y : d.added) x.insert(y);
+}
+
+//! @brief Applies changes to a value (sorted set overload).
+inline void apply_delta(device_set& x, id_delta const& d) {
+    for (device_t y : d.removed) x.erase(y);
+    for (device_t y : d.added) x.insert(y);
+}
+
+
+//! @brief Content of a versioned message.
+enum class version_kind : uint8_t {
+    current, //!< Only the version.
+    delta,   //!< Changes from the previous version.
+    full     //!< The whole value.
+};
+
+//! @brief Message exchanged by versioned_nbr.
+template <typename T>
+struct versioned_message {
+    //! @brief Version of the value of the sender.
+    size_t version = 0;
+    //! @brief Content of the message.
+    version_kind kind = version_kind::current;
+    //! @brief The whole value (if kind is full).
+    T value;
+    //! @brief Changes from the previous version (if kind is delta).
+    id_delta delta;
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        s & version & kind;
+        if (kind == version_kind::delta) s & delta;
+        if (kind == version_kind::full) s & value;
+        return s;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        s << version << kind;
+        if (kind == version_kind::delta) s << delta;
+        if (kind == version_kind::full) s << value;
+        return s;
+    }
+};
+
+//! @brief State kept by a device across rounds of versioned_nbr.
+template <typename T>
+struct versioned_state {
+    //! @brief Version of the value of the device (0 before the first round).
+    size_t version = 0;
+    //! @brief Value of the device.
+    T value;
+    //! @brief Whether the changes from the previous version are available.
+    bool has_delta = false;
+    //! @brief Changes from the previous version.
+    id_delta delta;
+    //! @brief Versions and values of neighbours, as last received.
+    std::unordered_map<device_t, tuple<size_t, T>> cache;
+
+    //! @brief Serialises the content from/to a given input/output stream.
+    template <typename S>
+    S& serialize(S& s) {
+        return s & version & value & has_delta & delta & cache;
+    }
+
+    //! @brief Serialises the content from/to a given input/output stream (const overload).
+    template <typename S>
+    S& serialize(S& s) const {
+        return s << version << value << has_delta << delta << cache;
+    }
+};
+
+
+/**
+ * @brief Field of the values of neighbours (as nbr), exchanging versions instead of values when unchanged.
+ *
+ * Every device sends the version of its value, together with the changes from the previous
+ * version when the value changed, or the whole value when some neighbour requests it.
+ * Neighbours keep the last value received by every device, and request the whole value through
+ * a field listing only the devices whose version they could not reconstruct (so that nothing but
+ * versions is exchanged while values are unchanged). Values which cannot be expressed as deltas
+ * are sent whole on change. Neighbours met for the first time are known only once their whole
+ * value arrives, a round later: until then, they take the value `missing`.
+ *
+ * The state kept across rounds (holding the values of every neighbour) is taken by value,
+ * updated and returned as the new state.
+ *
+ * @param value   The value of the device.
+ * @param missing The value of neighbours whose value has not been received yet.
+ * @param bytes   If given, set to the serialised size of the data exported by the device.
+ */
+GEN(T) field<T> versioned_nbr(ARGS, T const& value, T const& missing, size_t* bytes = nullptr) { CODE
+    field<T> result;
+    old(CALL, versioned_state<T>{}, [&](versioned_state<T> st){
+        // the value of the device exchanged in the previous round, as nbr would return
+        T prev = st.version ? st.value : value;
+        bool changed = st.version == 0 or st.value != value;
+        if (changed) {
+            st.has_delta = st.version > 0 and make_delta(st.value, value, st.delta);
+            st.value = value;
+            ++st.version;
+        }
+        // requests contain the version cached by neighbours plus one (0 for no request)
+        nbr(CALL, field<size_t>(0), [&](field<size_t> requests){
+            std::vector<device_t> const& ids = fcpp::details::get_ids(node.nbr_uid());
+            versioned_message<T> out;
+            out.version = st.version;
+            out.kind = changed ? version_kind::delta : version_kind::current;
+            for (device_t j : ids) if (j != node.uid) {
+                size_t r = fcpp::details::self(requests, j);
+                if (r == 0) continue;
+                // deltas only serve neighbours holding the previous version
+                if (r == st.version and out.kind == version_kind::current) out.kind = version_kind::delta;
+                if (r != st.version) out.kind = version_kind::full;
+            }
+            if (out.kind == version_kind::delta and not st.has_delta) out.kind = version_kind::full;
+            if (out.kind == version_kind::delta) out.delta = st.delta;
+            if (out.kind == version_kind::full) out.value = st.value;
+            field<versioned_message<T>> msgs = nbr(CALL, out);
+            // forgets the neighbours which are gone (identifiers in fields are sorted)
+            for (auto it = st.cache.begin(); it != st.cache.end(); )
+                it = std::binary_search(ids.begin(), ids.end(), it->first) ? std::next(it) : st.cache.erase(it);
+            // updates the values of neighbours, requesting those which cannot be reconstructed
+            std::vector<device_t> req_ids;
+            std::vector<size_t> req_vals{0};
+            for (device_t j : ids) if (j != node.uid) {
+                versioned_message<T> const& m = fcpp::details::self(msgs, j);
+                auto it = st.cache.find(j);
+                if (it == st.cache.end()) it = st.cache.emplace(j, tuple<size_t, T>{0, T{}}).first;
+                tuple<size_t, T>& c = it->second;
+                if (m.kind == version_kind::full) c = make_tuple(m.version, m.value);
+                if (m.kind == version_kind::delta and get<0>(c) > 0 and get<0>(c) + 1 == m.version) {
+                    apply_delta(get<1>(c), m.delta);
+                    get<0>(c) = m.version;
+                }
+                if (get<0>(c) != m.version) {
+                    req_ids.push_back(j);
+                    req_vals.push_back(get<0>(c) + 1);
+                }
+            }
+            // neighbours never received are left to `missing`, older versions are kept meanwhile
+            result = map_hood([&](device_t j){
+                if (j == node.uid) return prev;
+                tuple<size_t, T> const& c = st.cache.at(j);
+                return get<0>(c) > 0 ? get<1>(c) : missing;
+            }, node.nbr_uid());
+            field<size_t> req = fcpp::details::make_field(std::move(req_ids), std::move(req_vals));
+            if (bytes) {
+                size_stream s;
+                s << out << req;
+                *bytes = s.size();
+            }
+            return req;
+        });
+        return st;
+    });
+    return result;
+}
+//! @brief Export list for versioned_nbr.
+GEN_EXPORT(T) versioned_nbr_t = export_list<versioned_state<T>, versioned_message<T>, field<size_t>>;
+
+
+}
+
+}
+
+#endif // FCPP_VERSIONED_H_
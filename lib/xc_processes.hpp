@@ -8,13 +8,20 @@
 #ifndef FCPP_XC_PROCESSES_H_
 #define FCPP_XC_PROCESSES_H_
 
+#include <array>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "lib/common/option.hpp"
 #include "lib/component/calculus.hpp"
 #include "lib/option/distribution.hpp"
 
+#include "lib/admission.hpp"
 #include "lib/generals.hpp"
+#include "lib/routing.hpp"
+#include "lib/traffic.hpp"
+#include "lib/versioned.hpp"
 #include "lib/xc_setup.hpp"
 
 /**
@@ -22,31 +29,88 @@
  */
 namespace fcpp {
 
+//! @cond INTERNAL
+namespace details {
+    //! @brief Whether a key set is a hashed container (general overload).
+    template <typename S, typename = void>
+    struct is_hashed : std::false_type {};
+
+    //! @brief Whether a key set is a hashed container (hashed overload).
+    template <typename S>
+    struct is_hashed<S, std::conditional_t<true, void, typename S::hasher>> : std::true_type {};
+
+    //! @brief Membership index of a key set, to be built once per round (hashed containers, used in place).
+    template <typename K, typename S, bool = is_hashed<S>::value>
+    class key_index {
+      public:
+        //! @brief Constructor from the key set.
+        key_index(S const& key_set) : m_keys(key_set) {}
+
+        //! @brief Whether a key belongs to the key set.
+        bool count(K const& k) const {
+            return m_keys.count(k) > 0;
+        }
+
+      private:
+        //! @brief Reference to the key set.
+        S const& m_keys;
+    };
+
+    //! @brief Membership index of a key set, to be built once per round (general containers).
+    template <typename K, typename S>
+    class key_index<K, S, false> {
+      public:
+        //! @brief Constructor from the key set, hashing it only if larger than `linear_max`.
+        key_index(S const& key_set) : m_size(0) {
+            for (K const& k : key_set) {
+                if (m_size < linear_max) m_keys[m_size] = k;
+                else {
+                    if (m_size == linear_max) m_hashed.insert(m_keys.begin(), m_keys.end());
+                    m_hashed.insert(k);
+                }
+                ++m_size;
+            }
+        }
+
+        //! @brief Whether a key belongs to the key set.
+        bool count(K const& k) const {
+            if (m_size > linear_max) return m_hashed.count(k) > 0;
+            for (size_t i = 0; i < m_size; ++i) if (m_keys[i] == k) return true;
+            return false;
+        }
+
+      private:
+        //! @brief Maximum size of key sets checked linearly.
+        static constexpr size_t linear_max = 8;
+        //! @brief Number of keys in the key set.
+        size_t m_size;
+        //! @brief Keys of small key sets.
+        std::array<K, linear_max> m_keys;
+        //! @brief Keys of large key sets.
+        std::unordered_set<K, common::hash<K>> m_hashed;
+    };
+}
+//! @endcond
+
 //! @brief Handles a process, spawning instances of it for every key in the `key_set` and passing general arguments `xs` (overload with field<bool> status).
 template <typename node_t, typename G, typename S, typename... Ts, typename K = typename std::decay_t<S>::value_type, typename T = std::decay_t<std::result_of_t<G(K const&, Ts const&...)>>, typename R = std::decay_t<tuple_element_t<0,T>>, typename B = std::decay_t<tuple_element_t<1,T>>>
 std::enable_if_t<std::is_same<B,field<bool>>::value, std::unordered_map<K, R>>
 spawn(node_t& node, trace_t call_point, G&& process, S&& key_set, Ts const&... xs) {
+    // membership of keys is indexed once, and checked for every running process
+    details::key_index<K, std::decay_t<S>> index(key_set);
     return spawn(node, call_point, [&](K const& k, auto const&... params){
         return nbr(node, call_point, field<bool>(false), [&](field<bool> n){
             bool b = false;
             R ret;
             field<bool> fb = false;
 
-            bool found=false;
-            for (auto it = key_set.cbegin(); it < key_set.cend(); it++) {
-                if (*it == k) {
-                    found = true;
-                    break;
-                }
-            }
-
-            if (coordination::any_hood(node, call_point, n) or found) {
+            if (coordination::any_hood(node, call_point, n) or index.count(k)) {
                 tie(ret, fb) = process(k, params...);
                 b = coordination::any_hood(node, call_point, fb) or other(fb);
             }
             return make_tuple(make_tuple(ret, b), fb);
         });
-    }, std::forward<S>(key_set), xs...);
+    }, key_set, xs...);
 }
 
 //! @brief Namespace containing the libraries of coordination routines.
@@ -62,22 +126,6 @@ constexpr size_t period = 1;
 constexpr size_t comm = 100;
 
 
-//! @brief Possibly generates a message, given the number of devices and the experiment tag.
-FUN common::option<message> get_message(ARGS, size_t devices) {
-    common::option<message> m;
-    #ifndef MULTI_TEST
-    bool genmsg = node.uid == devices-1 && node.current_time() > 10 && node.storage(tags::sent_count{}) == 0;
-    #else
-    bool genmsg = node.uid >= devices-10 && node.current_time() > 1 && node.current_time() < 26 && node.next_real() < 0.05;
-    #endif
-    // random message with 1% probability during time [10..50]
-    if (genmsg) {
-        m.emplace(node.uid, (device_t)node.next_int(devices-1), node.current_time(), node.next_real());
-        node.storage(tags::sent_count{}) += 1;
-    }
-    return m;
-}
-
 //! @brief Result type of spawn calls dispatching messages.
 // TODO ****check --> should be size_t
 using message_log_type = std::unordered_map<message, double, fcpp::common::hash<message>>;
@@ -88,11 +136,13 @@ GEN(T) void proc_stats(ARGS, message_log_type const& nm, bool render, T) {
     // import tags for convenience
     using namespace tags;
     // stats on number of active processes
-    int proc_num = node.storage(proc_data{}).size() - 1;
+    int proc_num = node.storage(proc_count{});
 #ifdef ALLPLOTS
     node.storage(max_proc<T>{}) = max(node.storage(max_proc<T>{}), proc_num);
 #endif
     node.storage(tot_proc<T>{}) += proc_num;
+    node.storage(peak_proc<T>{}) = proc_num;
+#ifndef HEADLESS
     // additional node rendering
     if (render) {
         if (proc_num > 0) node.storage(node_size{}) *= 1.5;
@@ -100,51 +150,80 @@ GEN(T) void proc_stats(ARGS, message_log_type const& nm, bool render, T) {
         node.storage(left_color{})  = node.storage(proc_data{})[min(proc_num, 2)];
         node.storage(right_color{}) = node.storage(proc_data{})[min(proc_num, 3)];
     }
+#endif
     // stats on delivery success
-    old(node, call_point, message_log_type{}, [&](message_log_type m){
-        for (auto const& x : nm) if (x.first.to == node.uid) {
-            if (m.count(x.first)) {
+    for (auto const& x : nm) if (x.first.to == node.uid) {
+        if (node.storage(delivered<T>{}).insert(x.first, node.current_time(), delivery_horizon)) {
+            node.storage(first_delivery_tot<T>{}) += x.second - x.first.time;
+            node.storage(delivery_count<T>{}) += 1;
+        } else {
 #ifdef ALLPLOTS
-                node.storage(repeat_count<T>{}) += 1;
+            node.storage(repeat_count<T>{}) += 1;
 #endif
-            } else {
-                node.storage(first_delivery_tot<T>{}) += x.second - x.first.time;
-                node.storage(delivery_count<T>{}) += 1;
-                m[x.first] = x.second;
-            }
         }
-        return m;
-    });
+    }
 }
-//! @brief Export list for proc_stats.
-FUN_EXPORT proc_stats_t = export_list<message_log_type>;
 
-//! @brief Wrapper calling a spawn function with a given process and key set, while tracking the processes executed.
+/**
+ * @brief Wrapper calling a spawn function with a given process and key set, while tracking the processes executed.
+ *
+ * The process is called with a message, a real parameter and a `size_stream` holding the
+ * key and status of the process instance, to which the process adds every value it shares
+ * with neighbours (through `nbr` or `old`), so that its share of the export is measured.
+ */
 GEN(T,G,S) void spawn_profiler(ARGS, T, G&& process, S&& key_set, real_t v, bool render) {
     // clear up stats data
+    node.storage(tags::proc_count{}) = 0;
+#ifndef HEADLESS
     node.storage(tags::proc_data{}).clear();
     node.storage(tags::proc_data{}).push_back(color::hsva(0, 0, 0.3, 1));
+#endif
+    // admission control of processes
+    admission_state& adm = node.storage(tags::admission<T>{});
+    adm.begin(node.storage(tags::proc_cap{}), node.storage(tags::proc_ttl{}), delivery_horizon, node.current_time());
+    eviction_order e = eviction_order(node.storage(tags::eviction{}));
+    auto rank = [&](message const& m){
+        return process_rank(node, e, m);
+    };
     // dispatches messages
     message_log_type r = spawn(node, call_point, [&](message const& m){
-        auto r = process(m, v);
+        if (not adm.admit(m, rank)) {
+            std::decay_t<decltype(process(m, v, std::declval<size_stream&>()))> t{};
+            get<1>(t) = refused_status(get<1>(t));
+            return t;
+        }
+        size_stream ss;
+        auto r = process(m, v, ss);
+        node.storage(tags::proc_count{}) += 1;
+        // size of the share of the export of the process: key, status and values shared by its body
+        ss << m << get<1>(r);
+        node.storage(tags::max_msg_size<T>{}) = std::max(node.storage(tags::max_msg_size<T>{}), ss.size());
+        node.storage(tags::tot_msg_size<T>{}) += ss.size();
+#ifndef HEADLESS
         // TODO **** adapt to field<bool>
         //real_t key = get<0>(r) == status::external ? 0.5 : 1;
         real_t key = get<0>(r) ? 0.5 : 1;
         //real_t key = 1;
         node.storage(tags::proc_data{}).push_back(color::hsva(m.data * 360, key, key));
+#endif
         return r;
     }, std::forward<S>(key_set));
+    for (message const& m : adm.dropped()) r.erase(m);
+    node.storage(tags::rejected_count<T>{}) += adm.rejected();
+    node.storage(tags::evicted_count<T>{}) += adm.evicted();
+    adm.end();
 
     // compute stats
     proc_stats(CALL, r, render, T{});
 }
 //! @brief Export list for spawn_profiler.
-FUN_EXPORT spawn_profiler_t = export_list<spawn_t<message, bool>, spawn_t<message, status>, proc_stats_t, nvalue<bool>>;
+FUN_EXPORT spawn_profiler_t = export_list<spawn_t<message, bool>, spawn_t<message, status>, nvalue<bool>>;
 
 //! @brief Makes test for spherical processes.
 GEN(T) void spherical_test(ARGS, common::option<message> const& m, T, bool render = false) { CODE
-    spawn_profiler(CALL, tags::spherical<T>{}, [&](message const& m, real_t v){
+    spawn_profiler(CALL, tags::spherical<T>{}, [&](message const& m, real_t v, size_stream& ss){
         int rnd = counter(CALL);
+        ss << rnd;
         nvalue<bool> fdwav = false;
 
         if (m.to != node.uid and rnd <= 2) {
@@ -158,17 +237,44 @@ GEN(T) void spherical_test(ARGS, common::option<message> const& m, T, bool rende
 }
 FUN_EXPORT spherical_test_t = export_list<spawn_profiler_t, double, monotonic_distance_t, bool, int>;
 
+#if defined(BLOOM)
+#ifndef BLOOM_BITS
+//! @brief Number of bits in Bloom routing sets.
+#define BLOOM_BITS 256
+#endif
+#ifndef BLOOM_HASHES
+//! @brief Number of hash functions in Bloom routing sets.
+#define BLOOM_HASHES 3
+#endif
+//! @brief Routing set type (Bloom filter of descendants).
+using set_t = bloom_filter<BLOOM_BITS, BLOOM_HASHES>;
+#elif defined(INTERVAL)
+//! @brief Routing set type (interval of DFS labels of descendants).
+using set_t = interval_label;
+#elif defined(HASHSET)
+//! @brief Routing set type (exact hash set of descendants).
 using set_t = std::unordered_set<device_t>;
+#else
+//! @brief Routing set type (exact sorted set of descendants).
+using set_t = device_set;
+#endif
 
 //! @brief Makes test for tree processes.
-GEN(T,S) void tree_test(ARGS, common::option<message> const& m, nvalue<device_t> fdneigh, nvalue<device_t> fdparent, nvalue<S> const& fdbelow, size_t set_size, T, int render = -1) { CODE
-    spawn_profiler(CALL, tags::tree<T>{}, [&](message const& m, real_t v){
+GEN(T,S) void tree_test(ARGS, common::option<message> const& m, nvalue<device_t> fdneigh, nvalue<device_t> fdparent, nvalue<S> const& fdbelow, forest_info const& forest, size_t set_size, T, int render = -1) { CODE
+    spawn_profiler(CALL, tags::tree<T>{}, [&](message const& m, real_t v, size_stream& ss){
         int rnd = counter(CALL);
+        ss << rnd;
         nvalue<bool> fdwav = false;
+        device_t hop = forest_hop(node, forest, m.to);
 
-        if (m.to != node.uid and rnd <= 2) {
+        if (m.to != node.uid and rnd <= 2 and hop != node.uid) {
+            // outside the tree of the destination: towards its root
+            fdwav = map_hood([&] (device_t d) {return d == hop;}, fdneigh);
+            fdwav = mod_self(CALL, fdwav, rnd == 1);
+        } else if (m.to != node.uid and rnd <= 2) {
+            device_t to = route_address(node, self(CALL, fdbelow), m.to);
             nvalue<bool> source_path  = map_hood([&] (device_t d) {return (d == self(CALL, fdparent));}, fdneigh);
-            nvalue<bool> dest_path = map_hood([&] (device_t d) {return (d == node.uid);}, fdparent) and map_hood([&] (S b) {return (b.count(m.to) > 0);}, fdbelow);
+            nvalue<bool> dest_path = map_hood([&] (device_t d) {return (d == node.uid);}, fdparent) and map_hood([&] (S const& b) {return (b.count(to) > 0);}, fdbelow);
 
             fdwav = source_path or dest_path;
             fdwav = mod_self(CALL, fdwav, rnd == 1);
@@ -183,23 +289,72 @@ FUN_EXPORT tree_test_t = export_list<spawn_profiler_t, double, monotonic_distanc
 
 //! @brief Standard deviation for distance estimations.
 constexpr size_t dist_dev = 30;
-//! @brief Generating distribution for distance estimations.
-std::weibull_distribution<real_t> dist_distr = distribution::make<std::weibull_distribution>(real_t(1), real_t(dist_dev*0.01));
+//! @brief Parameters of the generating distribution for distance estimations (read-only, hence shared by all threads).
+std::weibull_distribution<real_t>::param_type const dist_param = distribution::make<std::weibull_distribution>(real_t(1), real_t(dist_dev*0.01)).param();
+
+//! @brief Generating distribution for distance estimations (a fresh one on every use, so that parallel rounds share no state).
+inline std::weibull_distribution<real_t> dist_distr() {
+    return std::weibull_distribution<real_t>(dist_param);
+}
 
 //! @brief Adjusted nbr_dist value accounting for errors.
 FUN field<real_t> adjusted_nbr_dist(ARGS) {
-    return node.nbr_dist() * rand_hood(CALL, dist_distr) + node.storage(tags::speed{}) * comm / period * node.nbr_lag();
+    auto d = dist_distr();
+    return node.nbr_dist() * rand_hood(CALL, d) + node.storage(tags::speed{}) * comm / period * node.nbr_lag();
 }
-//! @brief Wave-like termination logic.
+//! @brief Distances in space and time from a source device.
+using source_distance = std::array<real_t, 2>;
+
+//! @brief Distances in space and time from a source device, and the time at which the source started measuring them.
+using source_gradient = std::pair<source_distance, times_t>;
+
+/**
+ * @brief Distances in space and time from the sources of FC tree processes, computed once for all processes from the same source.
+ *
+ * A gradient is started by a device when it originates a message, and runs in devices which
+ * ran a process from its source in the previous round, as recorded in `tags::live_sources`.
+ * Gradients are dropped by devices with no process from their source, and vanish with them.
+ * The time distance is measured since the gradient started, which is shared along with it,
+ * so that it can be adjusted for messages originated later (see `message_distance`).
+ */
+FUN std::unordered_map<device_t, source_gradient> source_distances(ARGS, common::option<message> const& m) { CODE
+    std::unordered_set<device_t> live = std::move(node.storage(tags::live_sources{}));
+    node.storage(tags::live_sources{}).clear();
+    common::option<device_t> start;
+    for (message const& x : m) start.emplace(x.from);
+    return spawn(CALL, [&](device_t src){
+        bool source = src == node.uid and old(CALL, true, false);
+        source_distance d = monotonic_distance(CALL, source, adjusted_nbr_dist(CALL), node.nbr_lag());
+        // devices joining the gradient take the earliest start among their neighbours
+        times_t t0 = nbr(CALL, node.current_time(), [&](field<times_t> t){
+            return source ? node.current_time() : min_hood(CALL, t);
+        });
+        return make_tuple(source_gradient{d, t0}, source or live.count(src) > 0);
+    }, start);
+}
+//! @brief Export list for source_distances.
+FUN_EXPORT source_distances_t = export_list<spawn_t<device_t, bool>, monotonic_distances_t<2>, times_t, bool>;
+
+//! @brief Distances in space and time from the source of a message, given the gradients from sources (infinite if none yet).
+inline source_distance message_distance(std::unordered_map<device_t, source_gradient> const& dist, message const& m) {
+    auto it = dist.find(m.from);
+    if (it == dist.end()) return {INF, INF};
+    source_distance d = it->second.first;
+    // the gradient may have started before the message was originated
+    d[1] -= std::max(m.time - it->second.second, times_t(0));
+    return d;
+}
+
+//! @brief Wave-like termination logic, given the distances from the source of the process.
 template <typename node_t, template<class> class T>
-void termination_logic(ARGS, status& s, real_t v, message const& m, T<tags::wispp>) {
+void termination_logic(ARGS, status& s, real_t v, source_distance const& d, size_stream& ss, T<tags::wispp>) {
     bool terminating = s == status::terminated_output;
+    ss << terminating;
     bool terminated = nbr(CALL, terminating, [&](field<bool> nt){
         return any_hood(CALL, nt) or terminating;
     });
-    bool source = m.from == node.uid and old(CALL, true, false);
-    double ds = monotonic_distance(CALL, source, adjusted_nbr_dist(CALL));
-    double dt = monotonic_distance(CALL, source, node.nbr_lag());
+    double ds = d[0];
+    double dt = d[1];
     bool slow = ds < v * comm / period * (dt - period);
     if (terminated or slow) {
         if (s == status::terminated_output) s = status::border_output;
@@ -209,67 +364,143 @@ void termination_logic(ARGS, status& s, real_t v, message const& m, T<tags::wisp
 }
 
 //! @brief Makes test for FC tree processes.
-GEN(T,S) void fc_tree_test(ARGS, common::option<message> const& m, device_t parent, S const& below, size_t set_size, T, int render = -1) { CODE
-    spawn_profiler(CALL, tags::tree<T>{}, [&](message const& m, real_t v){
+GEN(T,S) void fc_tree_test(ARGS, common::option<message> const& m, device_t parent, S const& below, forest_info const& forest, size_t set_size, T, int render = -1) { CODE
+    std::unordered_map<device_t, source_gradient> dist = source_distances(CALL, m);
+    spawn_profiler(CALL, tags::tree<T>{}, [&](message const& m, real_t v, size_stream& ss){
+        ss << parent;
         bool source_path = any_hood(CALL, nbr(CALL, parent) == node.uid) or node.uid == m.from;
-        bool dest_path = below.count(m.to) > 0;
+        bool dest_path = below.count(route_address(node, below, m.to)) > 0;
+        // outside the tree of the destination: along the hops towards its root
+        device_t hop = forest_hop(node, forest, m.to);
+        // (a neighbour's hop being the device also keeps the first device reached in the tree of the destination)
+        bool hop_path = forest.hops.empty() ? false : (any_hood(CALL, mod_self(CALL, nbr(CALL, hop) == node.uid, false)) or node.uid == m.from);
+        if (not forest.hops.empty()) ss << hop;
+        bool internal = hop == node.uid ? source_path or dest_path or hop_path : hop_path;
         status s = node.uid == m.to ? status::terminated_output :
-                   source_path or dest_path ? status::internal : status::external_deprecated;
-        termination_logic(CALL, s, v, m, tags::tree<tags::wispp>{});
+                   internal ? status::internal : status::external_deprecated;
+        node.storage(tags::live_sources{}).insert(m.from);
+        termination_logic(CALL, s, v, message_distance(dist, m), ss, tags::tree<tags::wispp>{});
         return make_tuple(node.current_time(), s);
     }, m, 0.3, render);
 }
 //! @brief Exports for the main function.
-FUN_EXPORT fc_tree_test_t = export_list<spawn_profiler_t>;
+FUN_EXPORT fc_tree_test_t = export_list<spawn_profiler_t, source_distances_t, device_t, bool>;
 
-using set_t = std::unordered_set<device_t>;
+//! @brief Number of random UIDs tested by every device to estimate false positives of its routing set.
+constexpr size_t fpr_samples = 64;
+
+/**
+ * @brief Estimates the false positive rate of a routing set, given the exact size of the subtree.
+ *
+ * The share of positives over `fpr_samples` random UIDs is corrected by the share expected
+ * from the subtree alone, so that the cost of a round does not grow with the network.
+ */
+FUN real_t false_positive_rate(ARGS, set_t const& below, size_t subtree, size_t devices) {
+    if (subtree >= devices) return 0;
+    size_t positives = 0;
+    for (size_t i = 0; i < fpr_samples; ++i) positives += below.count(node.next_int(devices-1));
+    real_t r = (real_t(positives) * devices / fpr_samples - subtree) / (devices - subtree);
+    return std::min(std::max(r, real_t(0)), real_t(1));
+}
 
 //! @brief Main case study function.
 MAIN() {
     // import tags for convenience
     using namespace tags;
     // random walk
-    size_t l = node.storage(side{});
-    rectangle_walk(CALL, make_vec(0,0,20), make_vec(l,l,20), node.storage(speed{}) * comm / period, 1);
+    {
+        PROFILE_SCOPE(prof_walk);
+        size_t l = node.storage(side{});
+        rectangle_walk(CALL, make_vec(0,0,20), make_vec(l,l,20), node.storage(speed{}) * comm / period, 1);
+    }
 
     #ifndef NOTREE
-    bool is_src = node.uid == 0;
+    // roots of the spanning forest
+    size_t k = node.storage(roots{});
+    bool is_src = node.uid < k;
     #else
     bool is_src = false;
     #endif
 
+    #ifndef HEADLESS
     bool highlight = is_src or node.uid == node.storage(devices{}) - 1;
     node.storage(node_shape{}) = is_src ? shape::icosahedron : highlight ? shape::cube : shape::sphere;
     node.storage(node_size{}) = highlight ? 20 : 10;
+    #endif
     // random message with 1% probability during time [10..50]
     common::option<message> m = get_message(CALL, node.storage(devices{}));
 
     #ifndef NOSPHERE
-    spherical_test(CALL, m, xc{}, true);
+    {
+        PROFILE_SCOPE(spherical<xc>);
+        spherical_test(CALL, m, xc{}, true);
+    }
     #endif
     #ifndef NOTREE
     // spanning tree definition
-    device_t parent = flex_parent(CALL, is_src, comm);
+    device_t parent;
+    {
+        PROFILE_SCOPE(prof_tree);
+        parent = flex_parent(CALL, is_src, comm);
+    }
+    // routes between the trees of the forest
+    forest_info forest;
+    size_t table_sent = 0;
+    // a single tree (rooted in device 0) needs no routes between trees
+    forest.root = 0;
+    if (k > 1) {
+        forest.root = forest_root(CALL, parent);
+        forest.hops = root_table(CALL, k, &table_sent);
+    }
+    node.storage(tree_root{}) = forest.root;
     // routing sets along the tree
-    set_t below = parent_collection(CALL, parent, set_t{node.uid}, [](set_t x, set_t const& y){
-        x.insert(y.begin(), y.end());
-        return x;
+    set_t below;
+    #ifdef INTERVAL
+    {
+        PROFILE_SCOPE(prof_routes);
+        below = interval_labelling(CALL, parent);
+    }
+    node.storage(dfs_label{}) = below.lo;
+    #else
+    {
+        PROFILE_SCOPE(prof_routes);
+        below = inplace_parent_collection(CALL, parent, set_t{node.uid}, [](set_t& x, set_t const& y){
+            merge_routes(x, y);
+        });
+    }
+    #ifdef BLOOM
+    // exact subtree sizes, measuring false positives of the filters
+    size_t subtree = parent_collection(CALL, parent, size_t(1), [](size_t x, size_t y){
+        return x + y;
     });
-    nvalue<set_t> fdbelow = nbr(CALL, below); 
+    node.storage(route_fpr{}) = false_positive_rate(CALL, below, subtree, node.storage(devices{}));
+    #endif
+    #endif
+    size_t sent;
+    // children not received yet are assumed to route as the node itself, which contains their routes
+    nvalue<set_t> fdbelow = versioned_nbr(CALL, below, below, &sent);
+    node.storage(route_sent{}) = sent + table_sent;
     nvalue<device_t> fdparent = nbr(CALL, parent); 
     nvalue<device_t> fdneigh = nbr_uid(CALL);
 
     common::osstream os;
     os << below;
+    node.storage(route_size{}) = os.size();
 
-    tree_test(CALL, m, fdneigh, fdparent, fdbelow, os.size(), xc{});
-    fc_tree_test(CALL, m, parent, below, os.size(), fc{});
+    {
+        PROFILE_SCOPE(tree<xc>);
+        tree_test(CALL, m, fdneigh, fdparent, fdbelow, forest, os.size(), xc{});
+    }
+    {
+        PROFILE_SCOPE(tree<fc>);
+        fc_tree_test(CALL, m, parent, below, forest, os.size(), fc{});
+    }
 
     #endif
 
 }
 //! @brief Exports for the main function.
-struct main_t : public export_list<rectangle_walk_t<3>, spherical_test_t, tree_test_t, flex_parent_t, parent_collection_t<set_t>, real_t> {};
+struct main_t : public export_list<rectangle_walk_t<3>, get_message_t, spherical_test_t, tree_test_t, fc_tree_test_t, flex_parent_t, forest_root_t, root_table_t, inplace_parent_collection_t<set_t>, parent_collection_t<size_t>, interval_labelling_t, versioned_nbr_t<set_t>, device_t, real_t> {};
 
 
 } // coordination
@@ -9,7 +9,9 @@
 #define FCPP_XC_SETUP_H_
 
 #include "lib/fcpp.hpp"
+#include "lib/admission.hpp"
 #include "lib/generals.hpp"
+#include "lib/results.hpp"
 
 
 /**
@@ -37,6 +39,12 @@ constexpr size_t dim = 3;
 //! @brief End of simulated time.
 constexpr size_t end = 50;
 
+//! @brief Time after which delivered messages are forgotten.
+constexpr size_t delivery_horizon = 20;
+
+//! @brief Initial number of messages logged as delivered to a device within the horizon (grows with the load).
+constexpr size_t delivery_capacity = 64;
+
 
 //! @brief Namespace for component options.
 namespace option {
@@ -83,6 +91,68 @@ struct var_def_t<speed> {
 #endif
 };
 
+//! @brief Default load for simulations (messages per 100 units of time).
+template <>
+struct var_def_t<load> {
+    constexpr static size_t value = 50;
+};
+
+//! @brief Default load ramp for simulations (percentage of the initial load).
+template <>
+struct var_def_t<ramp> {
+    constexpr static size_t value = 0;
+};
+
+//! @brief Default arrival process for simulations (index in `arrival_names`).
+template <>
+struct var_def_t<arrivals> {
+#ifndef MULTI_TEST
+    constexpr static size_t value = 0; // once
+#else
+    constexpr static size_t value = 1; // poisson
+#endif
+};
+
+//! @brief Default distribution of senders for simulations (index in `endpoint_names`).
+template <>
+struct var_def_t<senders> {
+#ifndef MULTI_TEST
+    constexpr static size_t value = 2; // single
+#else
+    constexpr static size_t value = 1; // hotspot
+#endif
+};
+
+//! @brief Default distribution of receivers for simulations (index in `endpoint_names`).
+template <>
+struct var_def_t<receivers> {
+    constexpr static size_t value = 0; // uniform
+};
+
+//! @brief Default maximum number of processes per device for simulations (0 for no maximum).
+template <>
+struct var_def_t<proc_cap> {
+    constexpr static size_t value = 0;
+};
+
+//! @brief Default maximum age of processes for simulations (0 for no maximum).
+template <>
+struct var_def_t<proc_ttl> {
+    constexpr static size_t value = 0;
+};
+
+//! @brief Default eviction order for simulations (index in `eviction_names`).
+template <>
+struct var_def_t<eviction> {
+    constexpr static size_t value = 0; // oldest
+};
+
+//! @brief Default number of roots of the spanning forest for simulations.
+template <>
+struct var_def_t<roots> {
+    constexpr static size_t value = 1;
+};
+
 //! @brief Default values for simulation parameters.
 template <typename T>
 constexpr size_t var_def = var_def_t<T>::value;
@@ -118,8 +188,13 @@ using test_aggr_t = aggregators<
     repeat_count<T<S>>,        aggregator::sum<size_t>,
 #endif
     tot_proc<T<S>>,            aggregator::sum<int>,
+    peak_proc<T<S>>,           aggregator::max<int>,
+    rejected_count<T<S>>,      aggregator::sum<size_t>,
+    evicted_count<T<S>>,       aggregator::sum<size_t>,
     first_delivery_tot<T<S>>,  aggregator::sum<times_t>,
-    delivery_count<T<S>>,      aggregator::sum<size_t>
+    delivery_count<T<S>>,      aggregator::sum<size_t>,
+    max_msg_size<T<S>>,        aggregator::max<size_t>,
+    tot_msg_size<T<S>>,        aggregator::sum<size_t>
 >;
 
 //! @brief Storage for a given test.
@@ -130,8 +205,15 @@ using test_store_t = tuple_store<
     repeat_count<T<S>>,        size_t,
 #endif
     tot_proc<T<S>>,            int,
+    peak_proc<T<S>>,           int,
+    rejected_count<T<S>>,      size_t,
+    evicted_count<T<S>>,       size_t,
+    admission<T<S>>,           coordination::admission_state,
     first_delivery_tot<T<S>>,  times_t,
-    delivery_count<T<S>>,      size_t
+    delivery_count<T<S>>,      size_t,
+    max_msg_size<T<S>>,        size_t,
+    tot_msg_size<T<S>>,        size_t,
+    delivered<T<S>>,           delivery_log<delivery_capacity>
 >;
 
 //! @brief Functors for a given test.
@@ -140,13 +222,99 @@ using test_func_t = log_functors<
     delivery_count<T<S>>,    functor::div<aggregator::sum<delivery_count<T<S>>>, distribution::constant<n<1>>>,
     //avg_delay<T<S>>,    functor::div<aggregator::sum<delivery_count<T<S>>>, distribution::constant<n<1>>>,
     avg_delay<T<S>>,    functor::div<aggregator::sum<first_delivery_tot<T<S>>>, aggregator::sum<delivery_count<T<S>>>>,
-    avg_proc<T<S>>,     functor::div<functor::diff<aggregator::sum<tot_proc<T<S>>>>, distribution::constant<i<devices>>>
+    delivery_rate<T<S>>, functor::diff<aggregator::sum<delivery_count<T<S>>>>,
+    avg_proc<T<S>>,     functor::div<functor::diff<aggregator::sum<tot_proc<T<S>>>>, distribution::constant<i<devices>>>,
+    avg_size<T<S>>,     functor::div<functor::diff<aggregator::sum<tot_msg_size<T<S>>>>, distribution::constant<i<devices>>>,
+    avgtot_size<T<S>>,  functor::div<aggregator::sum<tot_msg_size<T<S>>>, distribution::constant<i<devices>>>
 >;
 
 //! @brief Overall options (aggregator, storage, functors) for given tests.
 template <template<class> class T, typename... Ss>
 using test_option_t = common::type_sequence<test_aggr_t<T,Ss>..., test_store_t<T,Ss>..., test_func_t<T,Ss>...>;
 
+//! @brief Storage, aggregators and functors for the time profile of a given program section.
+template <typename T>
+using prof_option_t = common::type_sequence<
+    tuple_store<prof_time<T>, double>,
+    aggregators<prof_time<T>, aggregator::sum<double>>,
+    log_functors<avg_time<T>, functor::div<functor::diff<aggregator::sum<prof_time<T>>>, distribution::constant<i<devices>>>>
+>;
+
+//! @brief Lines for the time profile of every program section.
+using prof_lines_t = plot::join<
+    plot::value<avg_time<prof_walk>>,
+#ifndef NOSPHERE
+    plot::value<avg_time<spherical<xc>>>,
+#endif
+#ifndef NOTREE
+    plot::value<avg_time<prof_tree>>,
+    plot::value<avg_time<prof_routes>>,
+    plot::value<avg_time<tree<xc>>>,
+    plot::value<avg_time<tree<fc>>>,
+#endif
+    plot::none
+>;
+
+//! @brief Row columns for the time profile of a given program section.
+template <typename T>
+using prof_row_t = common::tagged_tuple_t<avg_time<T>, double>;
+
+//! @brief Row columns for a given test (values of the functors).
+template <template<class> class T, typename S>
+using test_row_t = common::tagged_tuple_t<
+    delivery_count<T<S>>,   double,
+    avg_delay<T<S>>,        double,
+    delivery_rate<T<S>>,    double,
+    avg_proc<T<S>>,         double,
+    aggregator::max<peak_proc<T<S>>>, int,
+    aggregator::sum<rejected_count<T<S>>>, size_t,
+    aggregator::sum<evicted_count<T<S>>>, size_t,
+    avg_size<T<S>>,         double,
+    avgtot_size<T<S>>,      double
+>;
+
+//! @brief The rows read by the plot document (general parameters, aggregated values and time).
+using row_t = row_cat_t<
+#ifdef PROFILE
+    prof_row_t<prof_walk>,
+#ifndef NOSPHERE
+    prof_row_t<spherical<xc>>,
+#endif
+#ifndef NOTREE
+    prof_row_t<prof_tree>,
+    prof_row_t<prof_routes>,
+    prof_row_t<tree<xc>>,
+    prof_row_t<tree<fc>>,
+#endif
+#endif
+#ifndef NOSPHERE
+    test_row_t<spherical, xc>,
+#endif
+#ifndef NOTREE
+    test_row_t<tree, xc>,
+    test_row_t<tree, fc>,
+    common::tagged_tuple_t<
+        aggregator::mean<route_size>,   double,
+        aggregator::mean<route_fpr>,    double,
+        aggregator::max<route_fpr>,     double,
+        aggregator::mean<route_sent>,   double
+    >,
+#endif
+    common::tagged_tuple_t<
+        offered_load,   double
+    >,
+    common::tagged_tuple_t<
+        seed,       uint_fast32_t,
+        tvar,       double,
+        dens,       double,
+        hops,       double,
+        speed,      double,
+        roots,      double,
+        load,       double,
+        plot::time, times_t
+    >
+>;
+
 
 //! @brief Dummy aggregator for functor tags.
 struct noaggr {
@@ -181,6 +349,20 @@ template <typename S, size_t t0 = 0>
 using row_plot_t = plot::join<
 single_plot_t<S, lines_t<avg_proc, noaggr>>,
 single_plot_t<S, lines_t<avg_delay, noaggr>>,
+single_plot_t<S, lines_t<avg_size, noaggr>>,
+single_plot_t<S, plot::value<offered_load>>,
+single_plot_t<S, lines_t<delivery_rate, noaggr>>,
+single_plot_t<S, lines_t<peak_proc, aggregator::max<int>>>,
+single_plot_t<S, lines_t<rejected_count, aggregator::sum<size_t>>>,
+single_plot_t<S, lines_t<evicted_count, aggregator::sum<size_t>>>,
+#ifdef PROFILE
+single_plot_t<S, prof_lines_t>,
+#endif
+#ifndef NOTREE
+single_plot_t<S, plot::value<aggregator::mean<route_size>>>,
+single_plot_t<S, plot::join<plot::value<aggregator::mean<route_fpr>>, plot::value<aggregator::max<route_fpr>>>>,
+single_plot_t<S, plot::value<aggregator::mean<route_sent>>>,
+#endif
 single_plot_t<S, lines_t<delivery_count, noaggr>>
 >;
 #else
@@ -221,13 +403,44 @@ using plot_t = plot::join<
 //     multi_filter_t<row_plot_t<dens, 50>,   tvar, hops, speed>,
 //     multi_filter_t<row_plot_t<hops, 50>,   tvar, dens, speed>,
 //     multi_filter_t<row_plot_t<speed, 50>,  tvar, dens, hops>,
-    multi_filter_t<row_plot_t<plot::time>, tvar, dens, hops, speed>
+#ifdef SATURATION
+    // many loads are compared: other pages show the default one
+    multi_filter_t<row_plot_t<plot::time>, tvar, dens, hops, speed, roots, load>
+#else
+    // a single load is run (possibly not the default one)
+    multi_filter_t<row_plot_t<plot::time>, tvar, dens, hops, speed, roots>
+#endif
+#if defined(ROOTS) && defined(SATURATION)
+    , multi_filter_t<row_plot_t<roots>, tvar, dens, hops, speed, load>
+#elif defined(ROOTS)
+    , multi_filter_t<row_plot_t<roots>, tvar, dens, hops, speed>
+#endif
+#ifdef SATURATION
+    , multi_filter_t<row_plot_t<load>, tvar, dens, hops, speed, roots>
+#endif
 >;
 
 
-//! @brief The general simulation options.
-DECLARE_OPTIONS(list,
+#if defined(PARALLEL) && defined(INTERVAL)
+#error "INTERVAL routing reads DFS labels from the storage of other devices, which is not safe with PARALLEL node rounds"
+#endif
+
+#if defined(INTERVAL) && defined(ROOTS)
+#error "INTERVAL routing labels every tree from 0, so that labels collide across the trees of a forest"
+#endif
+
+#if defined(PARALLEL) && defined(ROOTS)
+#error "ROOTS routing reads tree roots from the storage of other devices, which is not safe with PARALLEL node rounds"
+#endif
+
+//! @brief The general simulation options, logging to a plotter of type P.
+template <typename P>
+DECLARE_OPTIONS(options_t,
+#ifdef PARALLEL
+    parallel<true>,      // multithreading enabled on node rounds
+#else
     parallel<false>,     // no multithreading on node rounds
+#endif
     synchronised<false>, // optimise for asynchronous networks
     program<coordination::main>,   // program to be run (refers to MAIN in process_management.hpp)
     exports<coordination::main_t>, // export type list (types used in messages)
@@ -242,19 +455,58 @@ DECLARE_OPTIONS(list,
         devices,                        size_t,
         side,                           size_t,
         infospeed,                      double,
+#ifndef HEADLESS
         proc_data,                      std::vector<color>,
+#endif
+        proc_count,                     int,
+        live_sources,                   std::unordered_set<device_t>,
         sent_count,                     size_t,
         node_color,                     color,
         left_color,                     color,
         right_color,                    color,
         node_size,                      double,
-        node_shape,                     shape
+        node_shape,                     shape,
+        route_size,                     double,
+        route_fpr,                      double,
+        route_sent,                     double,
+        dfs_label,                      device_t,
+        roots,                          size_t,
+        tree_root,                      device_t,
+        load,                           double,
+        ramp,                           double,
+        arrivals,                       size_t,
+        senders,                        size_t,
+        receivers,                      size_t,
+        proc_cap,                       size_t,
+        proc_ttl,                       double,
+        eviction,                       size_t
     >,
     // the basic tags and corresponding aggregators to be logged
-#ifdef ALLPLOTS
     aggregators<
         sent_count,         aggregator::sum<size_t>
     >,
+    log_functors<
+        offered_load,       functor::diff<aggregator::sum<sent_count>>
+    >,
+#ifndef NOTREE
+    aggregators<
+        route_size,         aggregator::mean<double>,
+        route_fpr,          aggregator::combine<aggregator::mean<double>, aggregator::max<double>>,
+        route_sent,         aggregator::mean<double>
+    >,
+#endif
+#ifdef PROFILE
+    // time profile of program sections
+    prof_option_t<prof_walk>,
+#ifndef NOSPHERE
+    prof_option_t<spherical<xc>>,
+#endif
+#ifndef NOTREE
+    prof_option_t<prof_tree>,
+    prof_option_t<prof_routes>,
+    prof_option_t<tree<xc>>,
+    prof_option_t<tree<fc>>,
+#endif
 #endif
     // further options for each test
 #ifndef NOSPHERE
@@ -272,17 +524,29 @@ DECLARE_OPTIONS(list,
         speed,              functor::div<i<speed>, n<100>>,
         side,               i<side>,
         devices,            i<devices>,
+        roots,              i<roots>,
+        load,               functor::div<i<load>, n<100>>,
+        ramp,               functor::div<i<ramp>, n<100>>,
+        arrivals,           i<arrivals>,
+        senders,            i<senders>,
+        receivers,          i<receivers>,
+        proc_cap,           i<proc_cap>,
+        proc_ttl,           i<proc_ttl>,
+        eviction,           i<eviction>,
         tvar,               functor::div<i<tvar>, n<100>>,
         tavg,               distribution::weibull<n<period>, functor::mul<i<tvar>, n<period, 100>>>
     >,
     // general parameters to use for plotting
     extra_info<
+        seed,   uint_fast32_t,
         tvar,   double,
         dens,   double,
         hops,   double,
-        speed,  double
+        speed,  double,
+        roots,  double,
+        load,   double
     >,
-    plot_type<plot_t>, // the plot description to be used
+    plot_type<P>, // the plot description to be used
     dimension<dim>, // dimensionality of the space
     connector<connect::fixed<comm, 1, dim>>, // connection allowed within a fixed comm range
     shape_tag<node_shape>, // the shape of a node is read from this tag in the store
@@ -290,6 +554,9 @@ DECLARE_OPTIONS(list,
     color_tag<node_color, left_color, right_color> // colors of a node are read from these
 );
 
+//! @brief The general simulation options, logging directly to the plot document.
+using list = options_t<plot_t>;
+
 
 }
 
@@ -4,19 +4,157 @@
  * @file xcbatch.cpp
  * @brief Runs a single execution of the message dispatch case study with a graphical user interface.
  */
+#include <algorithm>
+#include <chrono>
+#include <cstring>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! @brief Batch runs do not render nodes.
+#define HEADLESS
 
 #include "lib/xc_processes.hpp"
 #include "lib/xc_setup.hpp"
+#include "lib/results.hpp"
 
 using namespace fcpp;
 
 //! @brief Number of identical runs to be averaged.
 constexpr int runs = 100;
 
-int main() {
+#ifdef ROOTS
+//! @brief Largest number of roots of the spanning forest (runs are repeated for every number from 1).
+constexpr int max_roots = 16;
+#else
+//! @brief Largest number of roots of the spanning forest (a single tree).
+constexpr int max_roots = 1;
+#endif
+
+#ifdef SATURATION
+//! @brief Difference between loads compared (messages per 100 units of time).
+constexpr int load_step = 25;
+//! @brief Number of loads compared (runs are repeated for every multiple of `load_step`).
+constexpr int load_steps = 16;
+#else
+//! @brief Difference between loads compared (unused).
+constexpr int load_step = 1;
+//! @brief Number of loads compared (a single load).
+constexpr int load_steps = 1;
+#endif
+
+#ifdef STREAM
+//! @brief The plotter type logged into by every single run (a file stream shared by all runs).
+using sink_t = row_stream<option::row_t>;
+#else
+//! @brief The plotter type logged into by every single run.
+using sink_t = row_buffer<option::plot_t>;
+#endif
+
+//! @brief The component type (batch simulator with given options).
+using comp_t = component::batch_simulator<option::options_t<sink_t>>;
+
+#ifdef PARALLEL
+//! @brief Number of threads running the node rounds of every run.
+size_t net_threads = 1;
+#endif
+
+//! @brief Runs the simulations on a given number of threads after resetting the sinks, returning the running time in seconds.
+template <typename L, typename F>
+double run_batch(L const& init_list, F&& reset, size_t threads) {
+    reset();
+    auto start = std::chrono::steady_clock::now();
+#ifdef PARALLEL
+    // runs are executed one at a time, spreading their node rounds over the threads
+    net_threads = threads;
+    batch::run(comp_t{}, init_list);
+#else
+    if (threads > 1) batch::run(comp_t{}, common::tags::dynamic_execution(threads), init_list);
+    else batch::run(comp_t{}, init_list);
+#endif
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Usage: `batch [threads=N] [scaling] [arrivals=A] [senders=E] [receivers=E] [load=L] [ramp=R] [cap=C] [ttl=T] [eviction=O]`.
+ *
+ * Runs are spread over N threads (all hardware threads by default), or with `PARALLEL`
+ * defined, the node rounds within every run are. With `scaling`, the runs are repeated
+ * with 1, 2, 4... up to N threads, reporting the speedup of each.
+ *
+ * Traffic is generated with arrivals A (`once`, `poisson` or `bursty`), senders and receivers
+ * distributed as E (`uniform`, `hotspot` or `single`), a load of L messages per 100 units of
+ * time (swept with `SATURATION` defined), increasing by R percent across the generation window.
+ *
+ * Every device runs at most C processes at once, none older than T (0 for no limits), evicting
+ * running processes in order O (`oldest`, `farthest` or `priority`) to admit new ones
+ * (`farthest` needs a single thread with `PARALLEL` defined).
+ */
+int main(int argc, char** argv) {
+    size_t threads = std::max(std::thread::hardware_concurrency(), 1u);
+    bool scaling = false;
+    int arrivals = option::var_def<option::arrivals>;
+    int senders = option::var_def<option::senders>;
+    int receivers = option::var_def<option::receivers>;
+    int load = option::var_def<option::load>;
+    int ramp = option::var_def<option::ramp>;
+    int cap = option::var_def<option::proc_cap>;
+    int ttl = option::var_def<option::proc_ttl>;
+    int eviction = option::var_def<option::eviction>;
+    bool valid = true;
+    for (int a = 1; a < argc; ++a) {
+        if (std::strncmp(argv[a], "threads=", 8) == 0) threads = std::max(std::stoi(argv[a] + 8), 1);
+        else if (std::strcmp(argv[a], "scaling") == 0) scaling = true;
+        else if (std::strncmp(argv[a], "arrivals=", 9) == 0) arrivals = coordination::traffic_parse(coordination::arrival_names, argv[a] + 9);
+        else if (std::strncmp(argv[a], "senders=", 8) == 0) senders = coordination::traffic_parse(coordination::endpoint_names, argv[a] + 8);
+        else if (std::strncmp(argv[a], "receivers=", 10) == 0) receivers = coordination::traffic_parse(coordination::endpoint_names, argv[a] + 10);
+        else if (std::strncmp(argv[a], "load=", 5) == 0) load = std::max(std::stoi(argv[a] + 5), 0);
+        else if (std::strncmp(argv[a], "ramp=", 5) == 0) ramp = std::max(std::stoi(argv[a] + 5), -100);
+        else if (std::strncmp(argv[a], "cap=", 4) == 0) cap = std::max(std::stoi(argv[a] + 4), 0);
+        else if (std::strncmp(argv[a], "ttl=", 4) == 0) ttl = std::max(std::stoi(argv[a] + 4), 0);
+        else if (std::strncmp(argv[a], "eviction=", 9) == 0) eviction = coordination::traffic_parse(coordination::eviction_names, argv[a] + 9);
+        else valid = false;
+        if (not valid or arrivals < 0 or senders < 0 or receivers < 0 or eviction < 0) {
+            std::cerr << "usage: " << argv[0] << " [threads=N] [scaling] [arrivals=once|poisson|bursty] [senders=uniform|hotspot|single] [receivers=uniform|hotspot|single] [load=L] [ramp=R] [cap=C] [ttl=T] [eviction=oldest|farthest|priority]" << std::endl;
+            return 1;
+        }
+    }
+#ifdef PARALLEL
+    // destinations are read from other nodes, which may be running their rounds meanwhile
+    if (eviction == int(coordination::eviction_order::farthest) and threads > 1) {
+        std::cerr << "eviction=farthest reads the position of other devices, which is not safe with PARALLEL node rounds: use threads=1" << std::endl;
+        return 1;
+    }
+#endif
+#ifdef SATURATION
+    int load_min = load_step;
+#else
+    int load_min = load;
+#endif
+    int load_max = load_min + (load_steps - 1) * load_step;
+#ifdef STREAM
+    // Rows logged by every run, streamed to file.
+    sink_t stream("plot/batch.csv");
+    auto plotter = [&stream](auto const&) {
+        return &stream;
+    };
+    auto reset = [&stream]() {
+        stream.reset();
+    };
+#else
     // Construct the plotter object.
     option::plot_t p;
+    // Rows logged by every run, indexed by seed, number of roots and load.
+    std::vector<sink_t> buffers(runs * max_roots * load_steps);
+    auto plotter = [&buffers, load_min](auto const& x) {
+        size_t r = (common::get<option::seed>(x) - 1) * max_roots + common::get<option::roots>(x) - 1;
+        return &buffers[r * load_steps + (common::get<option::load>(x) - load_min) / load_step];
+    };
+    auto reset = [&buffers]() {
+        for (auto& b : buffers) b.clear();
+    };
+#endif
     // Parameter values
     int tvar = option::var_def<option::tvar>;
     int hops = option::var_def<option::hops>;
@@ -25,12 +163,12 @@ int main() {
     int side = hops * (2*dens)/(2*dens+1.0) * comm / sqrt(2.0) + 0.5;
     int devices = dens*side*side/(3.141592653589793*comm*comm) + 0.5;
     double infospeed = (0.08*dens - 0.7) * speed * 0.01 + 0.075*dens*dens - 1.6*dens + 11;
-    // The component type (batch simulator with given options).
-    using comp_t = component::batch_simulator<option::list>;
     // The list of initialisation values to be used for simulations.
     auto init_list = batch::make_tagged_tuple_sequence(
             batch::arithmetic<option::seed>(1, runs, 1),
-            batch::constant<option::tvar, option::dens, option::hops, option::speed, option::side, option::devices, option::infospeed, option::output, option::plotter>(
+            batch::arithmetic<option::roots>(1, max_roots, 1),
+            batch::arithmetic<option::load>(load_min, load_max, load_step),
+            batch::constant<option::tvar, option::dens, option::hops, option::speed, option::side, option::devices, option::infospeed, option::ramp, option::arrivals, option::senders, option::receivers, option::proc_cap, option::proc_ttl, option::eviction, option::output>(
                 tvar,
                 dens,
                 hops,
@@ -38,22 +176,59 @@ int main() {
                 side,
                 devices,
                 infospeed,
-                nullptr,
-                &p
-            )
+                ramp,
+                arrivals,
+                senders,
+                receivers,
+                cap,
+                ttl,
+                eviction,
+                nullptr
+            ),
+            // every run logs into the buffer of its own seed, roots and load (or the shared stream)
+            batch::formula<option::plotter, sink_t*>(plotter)
+#ifdef PARALLEL
+            , batch::formula<option::threads, size_t>([](auto const&) {
+                return net_threads;
+            })
+#endif
     );
     std::cout << "/*\n";
+    common::osstream os;
+    os << message(devices-1, 0, end, 0.5);
     std::cout << "side: " << side 
               << "\ndevices: " << devices
               << "\nspeed: " << speed
+              << "\nroots: 1.." << max_roots
+              << "\ntraffic: " << coordination::arrival_names[arrivals] << " arrivals from " << coordination::endpoint_names[senders] << " senders to " << coordination::endpoint_names[receivers] << " receivers, load " << load_min << ".." << load_max << " per 100 time units, ramp " << ramp << "%"
+              << "\nprocesses: cap " << cap << ", ttl " << ttl << ", eviction " << coordination::eviction_names[eviction]
+              << "\nmessage size: " << sizeof(message) << " bytes in memory, " << os.size() << " bytes exported"
               << "\n";
-    {
+    if (scaling) {
+        double base = 0;
+        for (size_t t = 1; t < threads; t *= 2) {
+            double time = run_batch(init_list, reset, t);
+            if (t == 1) base = time;
+            std::cout << "threads: " << t << "\truntime: " << time << " s\tspeedup: " << base / time << "\n";
+        }
+        double time = run_batch(init_list, reset, threads);
+        if (threads == 1) base = time;
+        std::cout << "threads: " << threads << "\truntime: " << time << " s\tspeedup: " << base / time << "\n";
+    } else {
         // Runs the given simulations.
-        batch::run(comp_t{}, init_list);
+        double time = run_batch(init_list, reset, threads);
+        std::cout << "threads: " << threads << "\nruntime: " << time << " s\n";
     }
+#ifdef STREAM
+    std::cout << "rows: plot/batch.csv\n";
+    std::cout << "*/\n";
+#else
     std::cout << "*/\n";
+    // Feeds the rows into the plotter in seed order, as a sequential run would.
+    replay(buffers, p);
 
     // Builds the resulting plots.
     std::cout << plot::file("batch", p.build(), {{"MAX_CROP", "0.5"}});
+#endif
     return 0;
 }
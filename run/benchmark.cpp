@@ -0,0 +1,132 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file benchmark.cpp
+ * @brief Runs microbenchmarks of the building blocks used by the case studies.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+//! @brief Benchmarks do not render nodes.
+#define HEADLESS
+
+#include "lib/benchmark.hpp"
+
+using namespace fcpp;
+
+//! @brief Number of heap allocations performed so far.
+std::atomic<size_t> allocations{0};
+
+//! @brief Counting replacement of the global allocation function.
+void* operator new(size_t n) {
+    ++allocations;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc{};
+}
+
+//! @brief Deallocation function matching the replacement above.
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+//! @brief Sized deallocation function matching the replacement above.
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+//! @brief Number of devices in the main sweep of benchmarks (enough for 200 neighbours on average).
+constexpr size_t sweep_devices = 400;
+
+//! @brief Runs a benchmark, printing its results as a JSON object.
+void benchmark(coordination::bench_block b, size_t devices, size_t dens, size_t procs, size_t set_size, bool first) {
+    // The network object type (batch simulator with benchmark options).
+    using net_t = component::batch_simulator<option::bench_list>::net;
+    size_t side = std::sqrt(devices * 3.141592653589793 / dens) * comm + 0.5;
+    auto init_v = common::make_tagged_tuple<option::bench_kind, option::bench_procs, option::bench_set, option::devices, option::side, option::output>(
+        size_t(b),
+        procs,
+        set_size,
+        devices,
+        side,
+        nullptr
+    );
+    coordination::bench_rounds = 0;
+    coordination::bench_sends = 0;
+    coordination::bench_bytes = 0;
+    double elapsed;
+    size_t allocs;
+    {
+        net_t network{init_v};
+        size_t start_allocs = allocations;
+        auto start = std::chrono::steady_clock::now();
+        network.run();
+        elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        allocs = allocations - start_allocs;
+    }
+    double rounds = coordination::bench_rounds;
+    std::cout << (first ? "\n" : ",\n")
+              << "  {\"block\": \"" << coordination::bench_names[size_t(b)] << "\""
+              << ", \"devices\": " << devices
+              << ", \"nbrs\": " << dens
+              << ", \"procs\": " << procs
+              << ", \"set_size\": " << set_size
+              << ", \"ns_per_round\": " << elapsed / rounds
+              << ", \"rounds_per_sec\": " << rounds * 1e9 / elapsed
+              << ", \"allocs_per_round\": " << allocs / rounds
+              << ", \"bytes_per_round\": " << coordination::bench_bytes / std::max(double(coordination::bench_sends), 1.0)
+              << "}" << std::flush;
+}
+
+/**
+ * @brief Runs every building block on neighbourhoods of increasing size.
+ *
+ * Spawn-based blocks are also run with increasing numbers of concurrent processes (and
+ * replicated formulas with increasing numbers of formulas monitored), and
+ * parent collection with increasing numbers of UIDs contributed by every device.
+ * Parent collection of routing sets and hash sets is finally run on networks of
+ * increasing size. Costs per round are reported as a JSON array of objects.
+ */
+int main() {
+    using coordination::bench_block;
+    bool first = true;
+    std::cout << "[";
+    for (size_t dens : {10, 50, 200}) {
+        for (size_t b = 0; b < size_t(bench_block::SIZE); ++b) {
+            switch (bench_block(b)) {
+                case bench_block::spawn:
+                case bench_block::spawn_profiler:
+                case bench_block::somewhere:
+                case bench_block::somewhere_all:
+                case bench_block::distance_split:
+                case bench_block::distance_fused:
+                    for (size_t procs = 1; procs <= 256; procs *= 4) {
+                        benchmark(bench_block(b), sweep_devices, dens, procs, 1, first);
+                        first = false;
+                    }
+                    break;
+                case bench_block::parent_collection:
+                case bench_block::parent_collection_hash:
+                    for (size_t set_size = 1; set_size <= 64; set_size *= 8) {
+                        benchmark(bench_block(b), sweep_devices, dens, 0, set_size, first);
+                        first = false;
+                    }
+                    break;
+                default:
+                    benchmark(bench_block(b), sweep_devices, dens, 0, 1, first);
+                    first = false;
+            }
+        }
+    }
+    for (size_t n : {1000, 3000, 10000})
+        for (bench_block b : {bench_block::parent_collection, bench_block::parent_collection_hash}) {
+            benchmark(b, n, 10, 0, 1, first);
+            first = false;
+        }
+    std::cout << "\n]\n";
+    return 0;
+}
@@ -8,12 +8,25 @@
 
 #include "lib/xc_processes.hpp"
 #include "lib/xc_setup.hpp"
+#include "lib/results.hpp"
 
 using namespace fcpp;
 
+#ifdef STREAM
+//! @brief The plotter type (rows streamed to file as they are logged).
+using sink_t = row_stream<option::row_t>;
+#else
+//! @brief The plotter type (the plot document).
+using sink_t = option::plot_t;
+#endif
+
 int main() {
     // Construct the plotter object.
-    option::plot_t p;
+#ifdef STREAM
+    sink_t p("plot/graphic.csv");
+#else
+    sink_t p;
+#endif
     std::cout << "/*\n";
     int tvar = option::var_def<option::tvar>;
     int hops = option::var_def<option::hops>;
@@ -25,9 +38,9 @@ int main() {
     std::cout << "IS: " << infospeed << std::endl;
     {
         // The network object type (interactive simulator with given options).
-        using net_t = component::interactive_simulator<option::list>::net;
+        using net_t = component::interactive_simulator<option::options_t<sink_t>>::net;
         // The initialisation values (simulation name, non-deterministic threshold, device speed, plotter object).
-        auto init_v = common::make_tagged_tuple<option::name, option::tvar, option::dens, option::hops, option::speed, option::side, option::devices, option::infospeed, option::seed, option::plotter>(
+        auto init_v = common::make_tagged_tuple<option::name, option::tvar, option::dens, option::hops, option::speed, option::side, option::devices, option::roots, option::load, option::ramp, option::arrivals, option::senders, option::receivers, option::proc_cap, option::proc_ttl, option::eviction, option::infospeed, option::seed, option::plotter>(
             "Dispatch of Peer-to-peer Messages (" + to_string(dens) + " dev/neigh, " + to_string(hops) + " hops, " + to_string(speed) + "% speed, " + to_string(tvar) + "% tvar)",
             tvar,
             dens,
@@ -35,6 +48,15 @@ int main() {
             speed,
             side,
             devices,
+            option::var_def<option::roots>,
+            option::var_def<option::load>,
+            option::var_def<option::ramp>,
+            option::var_def<option::arrivals>,
+            option::var_def<option::senders>,
+            option::var_def<option::receivers>,
+            option::var_def<option::proc_cap>,
+            option::var_def<option::proc_ttl>,
+            option::var_def<option::eviction>,
             infospeed,
             1,
             &p
@@ -46,6 +68,8 @@ int main() {
     }
     // Plot simulation results.
     std::cout << "*/\n";
+#ifndef STREAM
     std::cout << plot::file("graphic", p.build());
+#endif
     return 0;
 }
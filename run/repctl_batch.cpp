@@ -6,23 +6,51 @@
  */
 
 // [INTRODUCTION]
+#include <algorithm>
+#include <cstring>
 #include <iostream>
+#include <string>
 
 //! Importing the FCPP library.
 #include "lib/replicated_pastctl.hpp"
+#include "lib/results.hpp"
 
 //! @brief Number of identical runs to be averaged.
 constexpr int runs = 12;
 
 
-//! @brief The main function.
-int main() {
+/**
+ * @brief The main function. Usage: `repctl_batch [shards=K] [shard=I] [merge]`.
+ *
+ * The sweep is split into K shards of consecutive runs (1 by default). The rows of every
+ * completed run are checkpointed in the `plot` directory, and runs already checkpointed are
+ * skipped. With `shard=I`, only shard I is run and no plot is produced, so that shards can
+ * be run by independent processes. With `merge`, no run is executed and the checkpoints
+ * of all shards are merged into the plot document.
+ */
+int main(int argc, char** argv) {
     using namespace fcpp;
 
-    // Construct the plotter object.
-    option::plotter_t p;
+    size_t shards = 1;
+    size_t shard = -1;
+    bool merge = false;
+    for (int a = 1; a < argc; ++a) {
+        if (std::strncmp(argv[a], "shards=", 7) == 0) shards = std::max(std::stoi(argv[a] + 7), 1);
+        else if (std::strncmp(argv[a], "shard=", 6) == 0) shard = std::stoi(argv[a] + 6);
+        else if (std::strcmp(argv[a], "merge") == 0) merge = true;
+        else {
+            std::cerr << "usage: " << argv[0] << " [shards=K] [shard=I] [merge]" << std::endl;
+            return 1;
+        }
+    }
+    if (shard != size_t(-1) and shard >= shards) {
+        std::cerr << "shard " << shard << " out of " << shards << " shards" << std::endl;
+        return 1;
+    }
+    // The plotter type logged into by every single run.
+    using log_t = row_log<option::row_t>;
     // The component type (batch simulator with given options).
-    using comp_t = component::batch_simulator<option::list>;
+    using comp_t = component::batch_simulator<option::options_t<log_t>>;
     // The list of initialisation values to be used for simulations.
     //double infospeed = 0.8 * communication_range;
     //    auto mylist = batch::make_tagged_tuple_sequence(batch::arithmetic<option::seed>(runs + 1, 40*runs, 1, 1, runs));
@@ -59,10 +87,39 @@ int main() {
                 double s = common::get<option::speed>(x);
                 return (0.08*d - 0.7) * s * 0.01 + 0.075*d*d - 1.6*d + 11;
             }),
-            batch::constant<option::output, option::plotter>(nullptr, &p) // reference to the plotter object
+            batch::constant<option::output, option::plotter>(nullptr, (log_t*)nullptr) // set for every run
     );
-    // Runs the given simulations.
-    batch::run(comp_t{}, init_list);
+    size_t n = init_list.size();
+    // Checkpoint file of a shard (covering runs from s*n/shards to (s+1)*n/shards).
+    auto path = [&](size_t s) {
+        return "plot/repctl_batch." + std::to_string(shards) + "-" + std::to_string(s) + ".csv";
+    };
+    // Runs the given simulations, skipping those already checkpointed.
+    for (size_t s = 0; s < shards and not merge; ++s) if (shard == size_t(-1) or shard == s) {
+        checkpoint_file<option::row_t> f(path(s));
+        for (size_t i = s*n/shards; i < (s+1)*n/shards; ++i) if (not f.done(i)) {
+            log_t l;
+            auto t = init_list[i];
+            common::get<option::plotter>(t) = &l;
+            comp_t::net network{t};
+            network.run();
+            f.save(i, l.rows());
+        }
+    }
+    if (shard != size_t(-1)) return 0;
+    // Construct the plotter object.
+    option::plotter_t p;
+    // Feeds the checkpointed rows into the plotter, in sweep order.
+    for (size_t s = 0; s < shards; ++s) {
+        checkpoint_file<option::row_t> f(path(s));
+        for (size_t i = s*n/shards; i < (s+1)*n/shards; ++i) {
+            if (not f.done(i)) {
+                std::cerr << "run " << i << " missing from " << path(s) << std::endl;
+                return 1;
+            }
+            for (auto const& r : f.runs().at(i)) p << r;
+        }
+    }
     // Builds the resulting plots.
     std::cout << plot::file("repctl_batch", p.build());
     return 0;
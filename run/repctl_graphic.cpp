@@ -9,16 +9,28 @@
 
 //! Importing the FCPP library.
 #include "lib/replicated_pastctl.hpp"
+#include "lib/results.hpp"
 
+#ifdef STREAM
+//! @brief The plotter type (rows streamed to file as they are logged).
+using sink_t = fcpp::row_stream<fcpp::option::row_t>;
+#else
+//! @brief The plotter type (the plot document).
+using sink_t = fcpp::option::plotter_t;
+#endif
 
 //! @brief The main function.
 int main() {
     using namespace fcpp;
 
     //! @brief The network object type (interactive simulator with given options).
-    using net_t = component::interactive_simulator<option::list>::net;
+    using net_t = component::interactive_simulator<option::options_t<sink_t>>::net;
     //! @brief Create the plotter object.
-    option::plotter_t p;
+#ifdef STREAM
+    sink_t p("plot/repctl_graphic.csv");
+#else
+    sink_t p;
+#endif
     //! @brief The initialisation values (simulation name).
     int tvar = option::var_def<option::tvar>;
     int hops = option::var_def<option::hops>;
@@ -36,6 +48,8 @@ int main() {
         network.run();
     }
     std::cout << "*/\n"; // avoid simulation output to interfere with plotting output
+#ifndef STREAM
     std::cout << plot::file("repctl_graphic", p.build()); // write plots
+#endif
     return 0;
 }
@@ -0,0 +1,42 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file repctl_replot.cpp
+ * @brief Regenerates the plots of the replicated Past-CTL case study from rows streamed to file.
+ */
+#include <fstream>
+#include <iostream>
+#include <string>
+
+//! Importing the FCPP library.
+#include "lib/replicated_pastctl.hpp"
+#include "lib/results.hpp"
+
+
+/**
+ * @brief The main function. Usage: `repctl_replot [name]`, reading `plot/name.csv` (`repctl_graphic` by default).
+ *
+ * The rows of `repctl_batch` are checkpointed instead, and replotted through its `merge` mode.
+ */
+int main(int argc, char** argv) {
+    using namespace fcpp;
+
+    std::string name = argc > 1 ? argv[1] : "repctl_graphic";
+    std::ifstream in("plot/" + name + ".csv");
+    if (not in) {
+        std::cerr << "cannot open plot/" << name << ".csv" << std::endl;
+        return 1;
+    }
+    // Construct the plotter object.
+    option::plotter_t p;
+    size_t malformed = read_rows<option::row_t>(in, [&p](option::row_t const& r) {
+        p << r;
+    });
+    if (malformed > 0) {
+        std::cerr << malformed << " malformed rows in plot/" << name << ".csv" << std::endl;
+        return 1;
+    }
+    // Builds the resulting plots.
+    std::cout << plot::file(name, p.build());
+    return 0;
+}
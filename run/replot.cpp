@@ -0,0 +1,58 @@
+// Copyright © 2024 Giorgio Audrito. All Rights Reserved.
+
+/**
+ * @file replot.cpp
+ * @brief Regenerates the plots of the message dispatch case study from rows streamed to file.
+ */
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+//! @brief No node is rendered while replotting.
+#define HEADLESS
+
+#include "lib/xc_processes.hpp"
+#include "lib/xc_setup.hpp"
+#include "lib/results.hpp"
+
+using namespace fcpp;
+
+/**
+ * @brief Usage: `replot [name]`, reading `plot/name.csv` (`batch` by default).
+ *
+ * The rows need to be produced with `-DSTREAM` and the same scenario flags used to compile
+ * this executable, which are needed to reconstruct the plot document.
+ */
+int main(int argc, char** argv) {
+    std::string name = argc > 1 ? argv[1] : "batch";
+    std::ifstream in("plot/" + name + ".csv");
+    if (not in) {
+        std::cerr << "cannot open plot/" << name << ".csv" << std::endl;
+        return 1;
+    }
+    std::vector<option::row_t> rows;
+    size_t malformed = read_rows<option::row_t>(in, [&rows](option::row_t const& r) {
+        rows.push_back(r);
+    });
+    if (malformed > 0) {
+        std::cerr << malformed << " malformed rows in plot/" << name << ".csv" << std::endl;
+        return 1;
+    }
+    // Runs may have been interleaved by threads: restores the order of a sequential run (by seed, roots and load).
+    auto run = [](option::row_t const& r) {
+        return std::make_tuple(common::get<option::seed>(r), common::get<option::roots>(r), common::get<option::load>(r));
+    };
+    std::stable_sort(rows.begin(), rows.end(), [&run](option::row_t const& x, option::row_t const& y) {
+        return run(x) < run(y);
+    });
+    // Construct the plotter object.
+    option::plot_t p;
+    for (auto const& r : rows) p << r;
+    // Builds the resulting plots.
+    if (name == "batch") std::cout << plot::file(name, p.build(), {{"MAX_CROP", "0.5"}});
+    else std::cout << plot::file(name, p.build());
+    return 0;
+}